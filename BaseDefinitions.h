@@ -26,7 +26,9 @@
 
 #define HTTP_OK 200
 #define HTTP_NO_CONTENT 204
+#define HTTP_UNSUPPORTED_MEDIA_TYPE 415
 #define HTTP_SERVER_ERROR 500
+#define HTTP_DECODE_ERROR -1 // not an HTTP status : the compressed response can't be decoded
 
 #define DEFAULT_HTTP_USERAGENT "ArduinoLib/2.4"
 
@@ -86,4 +88,27 @@ typedef struct {
     ScopeType   scope;
 } MessageContext;
 
+typedef struct {
+    uint32_t    connects;           // connections established
+    uint32_t    staleReconnects;    // idle keep-alive connections closed before a request
+    uint32_t    retries;            // idempotent requests sent again on a new connection
+    unsigned long lastConnectTime;  // ms
+    unsigned long totalConnectTime; // ms
+} ConnectionStats;
+
+// Priority classes of the requests queued for the network task
+enum OutboundLane {
+    OutboundInteractive = 0,        // messages & saga responses
+    OutboundBulk = 1                // StateObjects, logs & the other requests
+};
+
+typedef struct {
+    uint32_t    sent;               // requests sent
+    uint32_t    dropped;            // requests dropped (lane full or no connection)
+    uint32_t    promoted;           // bulk requests sent ahead of the interactive ones after waiting OutboundAgingLimit
+    unsigned long lastLatency;      // ms from the queuing to the response
+    unsigned long maxLatency;       // ms
+    unsigned long totalLatency;     // ms
+} OutboundLaneStats;
+
 #endif
\ No newline at end of file
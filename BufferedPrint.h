@@ -21,26 +21,45 @@
 template <size_t CAPACITY>
 class BufferedPrint : public Print {
   public:
-    BufferedPrint(Print& destination) : _destination(destination), _size(0) {}
+    BufferedPrint(Print& destination) : _destination(destination), _size(0), _debug(false) {}
 
     ~BufferedPrint() { flush(); }
 
+    using Print::write;
+
     virtual size_t write(uint8_t c) {
         _buffer[_size++] = c;
 
-        if (_size + 1 == CAPACITY) {
+        if (_size == CAPACITY) {
             flush();
         }
 
         return 1;
     }
 
+    virtual size_t write(const uint8_t* data, size_t size) {
+        if (_size + size > CAPACITY) {
+            flush();
+            if (size >= CAPACITY) {
+                // Too large to be buffered : send it as is
+                send(data, size);
+                return size;
+            }
+        }
+        memcpy(_buffer + _size, data, size);
+        _size += size;
+
+        if (_size == CAPACITY) {
+            flush();
+        }
+
+        return size;
+    }
+
     void flush() {
-        _buffer[_size] = '\0';
-        _destination.print(_buffer);
-        _size = 0;
-        if(_debug && Serial) {
-            Serial.print(_buffer);
+        if (_size > 0) {
+            send(_buffer, _size);
+            _size = 0;
         }
     }
 
@@ -51,8 +70,15 @@ class BufferedPrint : public Print {
   private:
     Print& _destination;
     size_t _size;
-    char _buffer[CAPACITY];
+    uint8_t _buffer[CAPACITY];
     bool _debug;
+
+    void send(const uint8_t* data, size_t size) {
+        _destination.write(data, size);
+        if(_debug && Serial) {
+            Serial.write(data, size);
+        }
+    }
 };
 
 #endif
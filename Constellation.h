@@ -40,29 +40,92 @@
 #include "BaseDefinitions.h"
 #include "BufferedPrint.h"
 #include "LinkedList.h"
+#include "StaticContainers.h"
+#include "MemoryProfiles.h"
+#include "DeltaPublisher.h"
+#include "TaskScheduler.h"
+#include "TlsSession.h"
+#include "MessagePack.h"
+#include "JsonArraySplitter.h"
+#include "Inflater.h"
+#include "StateObjectCache.h"
+#include "TraceRing.h"
+#include "InboundRing.h"
+#include "DedupFilter.h"
 #include "PackageDescriptor.h"
+#include "TypedCallback.h"
+#include "ResponseReader.h"
+#include "TimeSeries.h"
+#include "WindowAggregator.h"
+
+// Network task mode (ESP32 & Linux) : the network I/O & JSON parsing run in a dedicated task
+#if (defined(ESP32) || defined(__linux__)) && !defined(CONSTELLATION_NO_NETWORK_TASK)
+#define CONSTELLATION_NETWORK_TASK
+#include <mutex>
+#include "SpscQueue.h"
+#include "MpscQueue.h"
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+#endif
+
+// Linux : the format buffers are per thread, so that several threads can share an instance (with the network task)
+#ifdef __linux__
+#define CONSTELLATION_THREAD_LOCAL thread_local
+#else
+#define CONSTELLATION_THREAD_LOCAL
+#endif
+// ESP32 : thread_local would reserve the buffers on the stack of every FreeRTOS task (the idle tasks included) :
+// the tasks take turns instead, the format buffer being locked until the formatted text has been sent
+#if defined(ESP32) && defined(CONSTELLATION_NETWORK_TASK)
+#define CONSTELLATION_FORMAT_LOCK std::lock_guard<std::recursive_mutex> formatLock(formatMutex())
+#define CONSTELLATION_LOG_LOCK std::lock_guard<std::mutex> logLock(logMutex())
+#else
+#define CONSTELLATION_FORMAT_LOCK
+#define CONSTELLATION_LOG_LOCK
+#endif
+
+// Log format strings in flash (AVR & ESP8266)
+#if defined(ARDUINO_ARCH_AVR) || defined(ESP8266)
+#define CONSTELLATION_PSTR(s) PSTR(s)
+#define CONSTELLATION_VSNPRINTF vsnprintf_P
+#else
+#define CONSTELLATION_PSTR(s) (s)
+#define CONSTELLATION_VSNPRINTF vsnprintf
+#endif
+
+// Log calls below the compile-time level of the profile (TProfile::MinLogLevel) are removed with their arguments.
+// These macros are only defined inside this header.
+#define log_error(format, ...) do { if(TProfile::MinLogLevel >= Error) this->logMessage(Error, CONSTELLATION_PSTR(format), ##__VA_ARGS__); } while(0)
+#define log_info(format, ...) do { if(TProfile::MinLogLevel >= Info) this->logMessage(Info, CONSTELLATION_PSTR(format), ##__VA_ARGS__); } while(0)
+#define log_debug(format, ...) do { if(TProfile::MinLogLevel >= Debug) this->logMessage(Debug, CONSTELLATION_PSTR(format), ##__VA_ARGS__); } while(0)
+#define log_trace(format, ...) do { if(TProfile::MinLogLevel >= Trace) this->logMessage(Trace, CONSTELLATION_PSTR(format), ##__VA_ARGS__); } while(0)
 
-#define NETCLIENT_BUFFER_SIZE 256
-#define STRING_FORMAT_BUFFER 1024
-#define JSON_PARSER_BUFFER_SIZE 2560
 #define DEFAULT_SUBSCRIPTION_TIMEOUT 60000
-#define DEFAULT_SUBSCRIPTION_LIMIT 1
 #define SUBSCRIPTIONID_SIZE 36
+#define SAGAID_SIZE 11
 #define DEFAULT_REQUEST_TIMEOUT 5000
+#define RENEW_BACKOFF_MIN 500
+#define RENEW_BACKOFF_MAX 30000
 
-template<typename TNetworkClass>
+template<typename TNetworkClass, typename TProfile = DefaultProfile>
 class Constellation
 {
   private:
     TNetworkClass _netClient, _netClientSO, _netClientMsg;
     const char* _constellationHost;
     uint16_t _constellationPort;
-    const char* _constellationPath;
+    const char* _constellationPath = "/";
     const char* _sentinelName;
     const char* _packageName;
     const char* _accessKey;
     const char* _msgSubscriptionId;
     const char* _soSubscriptionId;
+    char _msgSubscriptionIdBuffer[SUBSCRIPTIONID_SIZE + 1];
+    char _soSubscriptionIdBuffer[SUBSCRIPTIONID_SIZE + 1];
     const char* _base64Authorization;
     const char* _userAgent = DEFAULT_HTTP_USERAGENT;
     uint16_t _httpTimeout = DEFAULT_REQUEST_TIMEOUT;
@@ -71,12 +134,24 @@ class Constellation
     void (*_msgCallbackWithContext)(JsonObject&, MessageContext);
     void (*_soCallback)(JsonObject&);
     bool (*_onClientConnected)(TNetworkClass&);
+    BufferedPrint<TProfile::NetClientBufferSize> _netClientBuffer { _netClient };
+    unsigned long _netClientLastUsed = 0;
+    TlsSession<TNetworkClass> _tlsSessions[3];      // request, messages & StateObjects connections
+    ConnectionStats _connectionStats = { 0, 0, 0, 0, 0 };
+    bool _messagePack = false;                      // MessagePack requested (opt-in)
+    volatile bool _serverMessagePack = false;       // the server answered in MessagePack
+    Inflater<TProfile::InflateWindowSize>* _inflater = NULL; // compressed responses (opt-in)
+    bool _inflating = false;                        // the inflater is decoding a response (its callbacks can send requests)
     typedef struct {
         MessageCallbackDescriptor descriptor;
         MESSAGE_CALLBACK_SIGNATURE;
         MESSAGE_CALLBACK_WCONTEXT_SIGNATURE;
+        bool (*typedInvoker)(JsonVariant&, MessageCallbackDescriptor&, void (*)(), MessageContext*);
+        void (*typedCallback)();    // the typed function, cast back by its invoker
+        bool typedWithContext;
         const char* id;
         bool isSagaCallback;
+        char sagaId[SAGAID_SIZE];
     } MessageCallbackSubscription;
     typedef struct {
         STATEOBJECT_CALLBACK_SIGNATURE;
@@ -90,33 +165,226 @@ class Constellation
         const char* name;
         DescriptorType type;
     } TypeDescriptorItem;
-    LinkedList<MessageCallbackSubscription> _msgCallbacks = LinkedList<MessageCallbackSubscription>();
-    LinkedList<StateObjectSubscription> _soCallbacks = LinkedList<StateObjectSubscription>();
-    LinkedList<TypeDescriptorItem> _typeDescriptors = LinkedList<TypeDescriptorItem>();
-    LinkedList<const char*> _msgGroups = LinkedList<const char*>();
-    
+    typedef struct {
+        int index;                  // next subscription to confirm (-1 when idle)
+        unsigned long nextAttempt;
+        uint16_t backoff;
+    } RenewalState;
+    RenewalState _msgRenewal = { -1, 0, 0 };
+    RenewalState _soRenewal = { -1, 0, 0 };
+    // Destination of the items split from a long-poll response
+    typedef struct {
+        Constellation* owner;
+        bool isStateObject;
+    } StreamTarget;
+    // StateObject pushed by a task (see publishStateObject)
+    typedef struct {
+        Constellation* owner;
+        const char* name;
+        StateObjectPublisher* publisher;
+        int lifetime;
+    } ScheduledPublisher;
+    // In heap-free mode, the containers, the responses & the outgoing JSON documents use fixed storage
+    template<typename T, int CAPACITY>
+    using List = typename std::conditional<TProfile::HeapFree, StaticList<T, CAPACITY>, LinkedList<T> >::type;
+    typedef typename std::conditional<TProfile::HeapFree, FixedString<TProfile::ResponseBufferSize>, String>::type ResponseString;
+    typedef typename std::conditional<TProfile::HeapFree, StaticJsonBuffer<TProfile::JsonWriterBufferSize>, DynamicJsonBuffer>::type JsonWriterBuffer;
+    // Destination of the body of a response : the stream (JSON streaming) or the response string
+    class BodySink : public Print {
+      public:
+        ResponseString* response;
+        Print* stream;
+        bool truncated;
+        BodySink(ResponseString* response, Print* stream) : response(response), stream(stream), truncated(false) {}
+        using Print::write;
+        virtual size_t write(uint8_t c) {
+            if(stream != NULL ? stream->write(c) != 1 : !response->concat((char)c)) {
+                truncated = true;
+                return 0;
+            }
+            return 1;
+        };
+        virtual size_t write(const uint8_t* data, size_t size) {
+            size_t written = stream != NULL ? stream->write(data, size) : append(*response, data, size);
+            if(written != size) {
+                truncated = true;
+            }
+            return written;
+        };
+      private:
+        template<size_t CAPACITY>
+        static size_t append(FixedString<CAPACITY>& response, const uint8_t* data, size_t size) {
+            return response.write(data, size);
+        };
+        static size_t append(String& response, const uint8_t* data, size_t size) {
+            response.reserve(response.length() + size);
+            for(size_t i = 0; i < size; i++) {
+                if(!response.concat((char)data[i])) {
+                    return i;
+                }
+            }
+            return size;
+        };
+    };
+    // StateObject of a publisher, printed straight into the request (its value isn't copied, see pushStateObject)
+    class PublisherStateObject {
+      public:
+        const char* name;
+        StateObjectPublisher* publisher;
+        int lifetime;
+        unsigned long now;          // of the push : the value is printed the same for each pass
+        size_t printTo(Print& out) {
+            size_t length = out.print("{\"Name\":");
+            length += printJsonString(out, name);
+            length += out.print(",\"Value\":");
+            length += publisher->printValue(out, now);
+            length += out.print(",\"Type\":");
+            length += printJsonString(out, publisher->typeName());
+            if(lifetime > 0) {
+                length += out.print(",\"Lifetime\":");
+                length += out.print(lifetime);
+            }
+            return length + out.print('}');
+        };
+        size_t measureLength() {
+            LengthPrint length;
+            printTo(length);
+            return length.length();
+        };
+      private:
+        static size_t printJsonString(Print& out, const char* text) {
+            static const char hex[] = "0123456789abcdef";
+            size_t length = out.print('"');
+            for(const uint8_t* c = (const uint8_t*)text; *c != '\0'; c++) {
+                if(*c == '"' || *c == '\\') {
+                    length += out.print('\\');
+                }
+                else if(*c < 0x20) {
+                    const char escaped[6] = { '\\', 'u', '0', '0', hex[*c >> 4], hex[*c & 15] };
+                    length += out.write((const uint8_t*)escaped, sizeof(escaped));
+                    continue;
+                }
+                length += out.write(*c);
+            }
+            return length + out.print('"');
+        };
+    };
+    List<MessageCallbackSubscription, TProfile::MaxMessageCallbacks> _msgCallbacks;
+    List<StateObjectSubscription, TProfile::MaxStateObjectLinks> _soCallbacks;
+    List<TypeDescriptorItem, TProfile::MaxTypeDescriptors> _typeDescriptors;
+    List<const char*, TProfile::MaxMessageGroups> _msgGroups;
+    ResponseString _response, _msgResponse, _soResponse;
+    DeltaPublisher<TProfile::MaxTrackedStateObjects> _deltaPublisher;
+    StateObjectCache<TProfile::StateObjectCacheSize> _soCache;
+    TraceRing<TProfile::TraceSize> _trace;
+    DedupFilter<TProfile::DedupMessages, TProfile::DedupStateObjects> _dedup;
+    InboundRing<TProfile::InboundRingSize> _inboundRing;   // messages read, waiting to be dispatched (see setDispatchBudget)
+    int _dispatchMaxCount = 0;                      // messages dispatched per call, 0 = all
+    unsigned long _dispatchMaxTime = 0;             // ms, 0 = no limit
+    bool _dispatching = false;
+    char _incomingItem[TProfile::IncomingItemSize];  // item being split from a long-poll response (see readItems)
+    bool _readingItems = false;
+    bool _msgPollPending = false;                   // a GetMessages waits for its response on _netClientMsg
+    bool _soPollPending = false;                    // a GetStateObjects waits for its response on _netClientSO
+    bool _deltaPublishing = false;
+    TaskScheduler<TProfile::MaxTasks> _scheduler;
+    ScheduledPublisher _publishers[TProfile::MaxPublishers];
+    int _publisherCount = 0;
+#ifdef CONSTELLATION_NETWORK_TASK
+    typedef struct {
+        bool isStateObject;
+        char json[TProfile::InboundSlotSize];                       // parsed in place
+        StaticJsonBuffer<TProfile::InboundSlotSize> jsonBuffer;
+        JsonObject* root;
+    } InboundSlot;
+    class OutboundSlot : public FixedString<TProfile::OutboundSlotSize> {  // serialized HTTP request
+      public:
+        using FixedString<TProfile::OutboundSlotSize>::operator=;
+        unsigned long queuedAt;                                     // millis() of the commit
+    };
+    typedef struct {
+        SpscQueue<InboundSlot, TProfile::NetworkQueueLength> inbound;
+        // Several publishers, one writer connection : the interactive lane is sent first (see sendOutbound)
+        MpscQueue<OutboundSlot, TProfile::InteractiveQueueLength> interactive;
+        MpscQueue<OutboundSlot, TProfile::NetworkQueueLength> bulk;
+        OutboundLaneStats laneStats[2];                             // written by the network task only
+        std::atomic<uint32_t> laneDropped[2];                       // by the publishers
+        bool bulkPromoted;                                          // the last request sent was an aged bulk one
+        std::atomic<bool> stopping;
+        int timeout;
+        int limit;
+#ifdef ESP32
+        std::atomic<TaskHandle_t> owner;
+        std::atomic<bool> stopped;
+#else
+        std::atomic<std::thread::id> owner;
+        std::thread thread;
+#endif
+    } NetworkTask;
+    NetworkTask* _networkTask = NULL;
+    std::mutex _deltaMutex;
+#endif
+
     void addTypeDescriptor(const char* typeName, DescriptorType descriptorType, TypeDescriptor typeDescriptor) {
         TypeDescriptorItem type;
         type.type = descriptorType;
         type.name = typeName;
         type.descriptor = typeDescriptor;
-        _typeDescriptors.add(type);
+        if(!_typeDescriptors.add(type)) {
+            log_error("Unable to add the type %s : too many types", typeName);
+        }
+    };
+    // Declares the StateObject type of a publisher, once
+    void addPublisherType(StateObjectPublisher& publisher) {
+        for(int i = 0; i < _typeDescriptors.size(); i++) {
+            TypeDescriptorItem type = _typeDescriptors.get(i);
+            if(type.type == StateObjectType && strcmp(type.name, publisher.typeName()) == 0) {
+                return;
+            }
+        }
+        TypeDescriptor type;
+        publisher.describe(type);
+        addStateObjectType(publisher.typeName(), type);
+    };
+    static void publishTask(void* arg) {
+        ScheduledPublisher* scheduled = (ScheduledPublisher*)arg;
+        scheduled->owner->pushStateObject(scheduled->name, *scheduled->publisher, scheduled->lifetime);
     };
-    bool registerMessageCallback(const char* id, bool isSagaCallback, MessageCallbackDescriptor descriptor, MESSAGE_CALLBACK_SIGNATURE, MESSAGE_CALLBACK_WCONTEXT_SIGNATURE) {
+    bool registerMessageCallback(const char* id, bool isSagaCallback, MessageCallbackDescriptor descriptor, MESSAGE_CALLBACK_SIGNATURE, MESSAGE_CALLBACK_WCONTEXT_SIGNATURE,
+            bool (*typedInvoker)(JsonVariant&, MessageCallbackDescriptor&, void (*)(), MessageContext*) = NULL, void (*typedCallback)() = NULL, bool typedWithContext = false) {
         if(subscribeToMessage()) {
             MessageCallbackSubscription mc;
-            mc.id = id;
+            mc.typedInvoker = typedInvoker;
+            mc.typedCallback = typedCallback;
+            mc.typedWithContext = typedWithContext;
+            mc.id = isSagaCallback ? NULL : id;
             mc.isSagaCallback = isSagaCallback;
+            if(isSagaCallback) {
+                // The saga id is generated by the caller : keep a copy
+                strncpy(mc.sagaId, id, SAGAID_SIZE - 1);
+                mc.sagaId[SAGAID_SIZE - 1] = '\0';
+            }
             mc.msgCallback = msgCallback;
             mc.msgCallbackWithContext = msgCallbackWithContext;
             mc.descriptor = descriptor;
-            _msgCallbacks.add(mc);
+            if(!_msgCallbacks.add(mc)) {
+                log_error("Unable to register the MessageCallback %s : too many callbacks", id);
+                return false;
+            }
             return true;
         }
         else {
             return false;
         }
     };
+    template<typename... Args>
+    bool registerTypedMessageCallback(const char* messageKey, MessageCallbackDescriptor descriptor, void (*callback)(), bool withContext) {
+        if(!TypedCallback<Args...>::describe(descriptor)) {
+            log_error("The descriptor of the MessageCallback %s doesn't match its arguments", messageKey);
+            return false;
+        }
+        return registerMessageCallback(messageKey, false, descriptor, NULL, NULL, TypedCallback<Args...>::invoke, callback, withContext);
+    };
     const char* getLevelLabel(LogLevel level) {
         switch(level) {
             case LevelError:
@@ -143,123 +411,258 @@ class Constellation
                 return "None";
         }
     };
-    String createUri(const char* method, const char * args[], int argsSize) {
-        String url = String(this->_constellationPath) + method;
+    void printUri(Print& out, const char* method, const char * args[], int argsSize) {
+        // Base URI path : "/<path>/rest/constellation/"
+        const char* path = this->_constellationPath;
+        size_t pathLength = strlen(path);
+        if(path[0] != '/') {
+            out.print('/');
+        }
+        out.print(path);
+        if(pathLength > 0 && path[pathLength - 1] != '/') {
+            out.print('/');
+        }
+        out.print("rest/constellation/");
+        out.print(method);
         if(args != NULL) {
             for (int i = 0; i + 1 < argsSize * 2; i+=2){
-                url += (i == 0) ? "?" : "&";
-                url += args[i];
-                url += "=";
-                url += urlEncode(args[i + 1]);
+                out.print((i == 0) ? '?' : '&');
+                out.print(args[i]);
+                out.print('=');
+                urlEncode(out, args[i + 1]);
             }
         }
-        return url;
-    };    
-    int sendPostRequest(const char* method, JsonObject& content, String* response) {
-        // Send request
-        if (!_netClient.connected() && !_netClient.connect(this->_constellationHost, this->_constellationPort)) {
-            log_error("Unable to establish the TCP connection to %s:%d (POST on %s)", this->_constellationHost, this->_constellationPort, method);
-            return false;
-        }
-        // Verify the client connection
-        if(this->_onClientConnected && !this->_onClientConnected(_netClient)) {
-            log_error("Unable to verify the network client connection");            
-            return false;
+    };
+    void printHeader(Print& out, const char* name, const char* value) {
+        out.print(name);
+        out.print(": ");
+        out.print(value);
+        out.print("\r\n");
+    };
+    void printRequest(Print& out, const char* verb, const char* method, const char * args[], int argsSize, bool keepAlive) {
+        out.print(verb);
+        out.print(' ');
+        printUri(out, method, args, argsSize);
+        out.print(" HTTP/1.1\r\n");
+        printHeader(out, "Host", this->_constellationHost);
+        printHeader(out, "SentinelName", this->_sentinelName);
+        printHeader(out, "PackageName", this->_packageName);
+        printHeader(out, "AccessKey", this->_accessKey);
+        printHeader(out, "User-Agent", this->_userAgent);
+        // A request sent by a callback while a response is inflated is answered uncompressed (one inflater)
+        printHeader(out, "Accept-Encoding", this->_inflater != NULL && !this->_inflating ? "gzip, deflate" : "identity");
+        if(this->_messagePack && (strcmp(method, "GetMessages") == 0 || strcmp(method, "GetStateObjects") == 0)) {
+            printHeader(out, "Accept", MESSAGEPACK_CONTENT_TYPE ", application/json");
         }
-        // We now create a URI for the request
-        String url = createUri(method, NULL, 0);
-        // Prepare the request        
-        static BufferedPrint<NETCLIENT_BUFFER_SIZE> buffer(_netClient);
-        log_debug("POST: %s", url.c_str());
-        buffer.setDebug((this->_debugMode >= (int8_t)Trace));
-        int contentLength = content.measureLength();
-        String request = "POST " + url + " HTTP/1.1\r\n" +
-                        "Host: " + this->_constellationHost + "\r\n" +                        
-                        "SentinelName: " + this->_sentinelName + "\r\n"  +
-                        "PackageName: " + this->_packageName + "\r\n"  +
-                        "AccessKey: " + this->_accessKey + "\r\n"  +                        
-                        "User-Agent: " + this->_userAgent + "\r\n"  +
-                        "Accept-Encoding: identity\r\n" +
-                        "Content-Length: " + contentLength + "\r\n"  +
-                        "Content-Type: application/json\r\n" +
-                        "Connection: keep-alive\r\n";
+        printHeader(out, "Connection", keepAlive ? "keep-alive" : "close");
         if(this->_base64Authorization) {
-            request += String("Authorization: Basic ") + this->_base64Authorization + "\r\n";
+            out.print("Authorization: Basic ");
+            out.print(this->_base64Authorization);
+            out.print("\r\n");
         }
-        request += "\r\n";
-        // This will send the request to the server
-        buffer.print(request);
-        content.printTo(buffer);
-        buffer.print("\r\n\r\n");
-        buffer.flush();
-        // Read the response
-        int statusCode = readResponse(&_netClient, response);
-        if(statusCode >= 300) {
-            log_error("Incorrect response: %d", statusCode);
-            if(response != NULL) {
-                log_debug(response->c_str());
-            }
+    };
+    void printPostRequest(Print& out, const char* method, JsonObject& content, bool messagePack) {
+        printRequest(out, "POST", method, NULL, 0, true);
+        out.print("Content-Length: ");
+        if(messagePack) {
+            out.print(MessagePackWriter::measure(content));
+            out.print("\r\nContent-Type: " MESSAGEPACK_CONTENT_TYPE "\r\n\r\n");
+            MessagePackWriter(out).write(content);
         }
         else {
-            log_debug("Return code: %d", statusCode);
+            out.print(content.measureLength());
+            out.print("\r\nContent-Type: application/json\r\n\r\n");
+            content.printTo(out);
         }
-        // Clean up
-        //_netClient.stop();
-        return statusCode;
-    };    
-    int sendRequest(const char* method, const char * args[], int argsSize, String* response) {
-        // Send request
-        if(!writeRequest(&_netClient, method, args, argsSize, true)) {
-            log_error("Unable to send the request !");
-            return false;
+        out.print("\r\n\r\n");
+    };
+    // The StateObject of a publisher is always in JSON
+    void printPostRequest(Print& out, const char* method, PublisherStateObject& content, bool) {
+        printRequest(out, "POST", method, NULL, 0, true);
+        out.print("Content-Length: ");
+        out.print(content.measureLength());
+        out.print("\r\nContent-Type: application/json\r\n\r\n");
+        content.printTo(out);
+        out.print("\r\n\r\n");
+    };
+    // 'content' : a JsonObject or a PublisherStateObject
+    template<typename TContent>
+    int sendPostRequest(const char* method, TContent& content, ResponseString* response, bool messagePack = false) {
+#ifdef CONSTELLATION_NETWORK_TASK
+        if(isQueuingRequests()) {
+            OutboundLane lane = outboundLane(method);
+            OutboundSlot* slot = reserveOutbound(method, lane, response);
+            if(slot == NULL) {
+                return 0;
+            }
+            printPostRequest(*slot, method, content, messagePack);
+            return commitOutbound(slot, lane, method);
         }
-        // Read the response
-        int statusCode = readResponse(&_netClient, response);
-         if(statusCode >= 300) {
-            log_error("Incorrect response: %d", statusCode);
-            if(response != NULL) {
-                log_debug(response->c_str());
+#endif
+        return exchange(method, NULL, 0, &content, response, messagePack);
+    };
+    int sendRequest(const char* method, const char * args[], int argsSize, ResponseString* response) {
+#ifdef CONSTELLATION_NETWORK_TASK
+        if(isQueuingRequests()) {
+            OutboundLane lane = outboundLane(method);
+            OutboundSlot* slot = reserveOutbound(method, lane, response);
+            if(slot == NULL) {
+                return 0;
             }
+            printRequest(*slot, "GET", method, args, argsSize, true);
+            slot->print("\r\n");
+            return commitOutbound(slot, lane, method);
         }
-        else {
-            log_debug("Return code: %d", statusCode);
+#endif
+        return exchange<JsonObject>(method, args, argsSize, NULL, response);
+    };
+    // Requests that can be sent again safely if the connection dies before the response
+    static bool isIdempotent(const char* method) {
+        return strcmp(method, "SendMessage") != 0 && strcmp(method, "WriteLog") != 0;
+    };
+    // Send a request (POST if 'content' is set) on the request connection and read the response.
+    // An idempotent request failing without response on a reused connection is sent again once on a new connection.
+    // An idempotent request whose compressed response can't be decoded is sent again once, without compression.
+    // A MessagePack body refused by the server (415) is sent again in JSON.
+    template<typename TContent>
+    int exchange(const char* method, const char * args[], int argsSize, TContent* content, ResponseString* response, bool messagePack = false) {
+        bool reused = false;
+        for(int attempt = 0; ; attempt++) {
+            // Send request
+            bool written = content != NULL ? writePostRequest(method, *content, messagePack, &reused) : writeRequest(&_netClient, method, args, argsSize, true, &reused);
+            if(!written) {
+                log_error("Unable to send the request !");
+                return false;
+            }
+            // Read the response
+            int statusCode = readResponse(&_netClient, response);
+            if(statusCode == HTTP_DECODE_ERROR) {
+                // The compression is now disabled : an idempotent request is sent again, answered uncompressed
+                if(attempt == 0 && isIdempotent(method)) {
+                    log_debug("Retrying %s uncompressed", method);
+                    if(_trace.enabled()) {
+                        _trace.record(TraceRetry, 0, fnv1a(method));
+                    }
+                    _connectionStats.retries++;
+                    if(response != NULL) {
+                        *response = "";
+                    }
+                    continue;
+                }
+                return 0;
+            }
+            if(statusCode == 0) {
+                // No (valid) response : the connection can't be trusted anymore
+                _netClient.stop();
+                if(reused && attempt == 0 && isIdempotent(method)) {
+                    log_debug("No response on the reused connection : retrying %s", method);
+                    if(_trace.enabled()) {
+                        _trace.record(TraceRetry, 0, fnv1a(method));
+                    }
+                    _connectionStats.retries++;
+                    if(response != NULL) {
+                        *response = "";
+                    }
+                    continue;
+                }
+            }
+            else {
+                _netClientLastUsed = millis();
+            }
+            if(statusCode == HTTP_UNSUPPORTED_MEDIA_TYPE && messagePack) {
+                log_info("MessagePack not supported by the server : back to JSON");
+                _serverMessagePack = false;
+                messagePack = false;
+                continue;
+            }
+            if(statusCode >= 300) {
+                log_error("Incorrect response: %d", statusCode);
+                if(response != NULL) {
+                    log_debug("%s", response->c_str());
+                }
+            }
+            else {
+                log_debug("Return code: %d", statusCode);
+            }
+            return statusCode;
         }
-        // Clean up
-        //_netClient.stop();
-        return statusCode;
     };
-    bool writeRequest(TNetworkClass* client, const char* method, const char * args[], int argsSize, bool keepAlive) {
-        if (!client->connected() && !client->connect(this->_constellationHost, this->_constellationPort)) {
-            log_error("Unable to establish the TCP connection to %s:%d (GET on %s)", this->_constellationHost, this->_constellationPort, method);
+    // Connection manager : reuses the keep-alive connection if it's still fresh, otherwise (re)connects and verifies the new connection
+    bool openClient(TNetworkClass* client, const char* verb, const char* method, bool* reused) {
+        if(client == &_netClient && client->connected() && (millis() - _netClientLastUsed > TProfile::ConnectionMaxIdle || client->available() > 0)) {
+            // The server or a NAT may have dropped this idle connection (or it has unexpected data) : don't wait for a timeout to find out
+            log_debug("Closing the stale request connection");
+            _trace.record(TraceStaleReconnect);
+            client->stop();
+            _connectionStats.staleReconnects++;
+        }
+        if(client->connected()) {
+            if(reused != NULL) {
+                *reused = true;
+            }
+            return true;
+        }
+        if(reused != NULL) {
+            *reused = false;
+        }
+        // Resume the previous TLS session of this connection if the network class supports it
+        uint8_t connection = client == &_netClient ? 0 : (client == &_netClientMsg ? 1 : 2);
+        _tlsSessions[connection].attach(*client);
+        unsigned long start = millis();
+        if(!client->connect(this->_constellationHost, this->_constellationPort)) {
+            log_error("Unable to establish the TCP connection to %s:%d (%s on %s)", this->_constellationHost, this->_constellationPort, verb, method);
+            _trace.record(TraceConnectFailed, connection);
             return false;
         }
-        // Verify the client connection
-        if(this->_onClientConnected && !this->_onClientConnected(_netClient)) {
-            log_error("Unable to verify the network client connection");            
+        _connectionStats.connects++;
+        _connectionStats.lastConnectTime = millis() - start;
+        _trace.record(TraceConnect, connection, _connectionStats.lastConnectTime);
+        _connectionStats.totalConnectTime += _connectionStats.lastConnectTime;
+        if(client == &_netClient) {
+            _netClientLastUsed = millis();
+        }
+        // Verify the new connection
+        if(this->_onClientConnected && !this->_onClientConnected(*client)) {
+            log_error("Unable to verify the network client connection");
+            client->stop();
             return false;
         }
-        // We now create a URI for the request
-        String url = createUri(method, args, argsSize);
-        log_debug("GET: %s", url.c_str());
-        // Prepare the request
-        String request = "GET " + url + " HTTP/1.1\r\n" +
-                        "Host: " + this->_constellationHost + "\r\n" +                        
-                        "SentinelName: " + this->_sentinelName + "\r\n"  +
-                        "PackageName: " + this->_packageName + "\r\n"  +
-                        "AccessKey: " + this->_accessKey + "\r\n"  +                        
-                        "User-Agent: " + this->_userAgent + "\r\n" +
-                        "Accept-Encoding: identity\r\n" +
-                        "Connection: " + (keepAlive ? "keep-alive" : "close") + "\r\n";
-        if(this->_base64Authorization) {
-            request += String("Authorization: Basic ") + this->_base64Authorization + "\r\n";
+        return true;
+    };
+    template<typename TContent>
+    bool writePostRequest(const char* method, TContent& content, bool messagePack, bool* reused) {
+        if(!openClient(&_netClient, "POST", method, reused)) {
+            return false;
         }
-        request += "\r\n";
+        log_debug("POST: %s", method);
+        if(_trace.enabled()) {
+            _trace.record(TraceRequest, 'P', fnv1a(method));
+        }
+        _netClientBuffer.setDebug(TProfile::EchoRequests && TProfile::MinLogLevel >= Trace && (this->_debugMode >= (int8_t)Trace));
         // This will send the request to the server
-        client->print(request);
+        printPostRequest(_netClientBuffer, method, content, messagePack);
+        _netClientBuffer.flush();
         return true;
     };
-    
-    int readResponse(TNetworkClass* client, String* response) {
+    bool writeRequest(TNetworkClass* client, const char* method, const char * args[], int argsSize, bool keepAlive, bool* reused = NULL) {
+        if(!openClient(client, "GET", method, reused)) {
+            return false;
+        }
+        log_debug("GET: %s", method);
+        if(_trace.enabled()) {
+            _trace.record(TraceRequest, 'G', fnv1a(method));
+        }
+        BufferedPrint<TProfile::NetClientBufferSize> buffer(*client);
+        buffer.setDebug(TProfile::EchoRequests && TProfile::MinLogLevel >= Trace && (this->_debugMode >= (int8_t)Trace));
+        // This will send the request to the server
+        printRequest(buffer, "GET", method, args, argsSize, keepAlive);
+        buffer.print("\r\n");
+        buffer.flush();
+        return true;
+    };
+    // The JSON body of a successful response is written to 'stream' (if set) rather than in 'response'.
+    // A compressed body goes through the inflater first.
+    int readResponse(TNetworkClass* client, ResponseString* response, bool* isMessagePack = NULL, Print* stream = NULL) {
         int statusCode = 0;
         if (!client->connected()) {
             return statusCode;
@@ -269,29 +672,64 @@ class Constellation
         while (client->available() == 0) {
             if ((millis() - timeout) > this->_httpTimeout) {
                 log_error("HTTP Timeout reached");
+                _trace.record(TraceResponseTimeout);
                 return 0;
             }
+            // Keep the tasks that don't use the network running while waiting
+            if(!isNetworkTaskStarted()) {
+                _scheduler.run(TProfile::MaxTasksPerTick, true);
+            }
+            yield();
         }
-        String line;
+        ResponseReader<TNetworkClass, TProfile::ResponseReadBufferSize> reader(client, this->_httpTimeout);
+        char line[HTTP_HEADER_LINE_SIZE];
         bool isChunked = false;
         bool firstLine = true;
         bool isBody = false;
+        bool isBinary = false;
+        InflateFormat encoding = InflateRaw;
+        BodySink sink(response, stream);
+        Print* body = &sink;
+        uint16_t headerLines = 0;
+        uint32_t bodyLength = 0;
         // Read the response
-        while (client->available()) {            
-            if (!isBody) { // Read the header                 
-                line = client->readStringUntil('\n');
-                line.trim();
-                log_trace("> %s", line.c_str());
-                if (firstLine && line.length() > 0) { // first line
-                    int spaceIndex = line.indexOf(' ');
-                    statusCode = line.substring(spaceIndex + 1, spaceIndex + 4).toInt();
+        while (reader.available()) {
+            if (!isBody) { // Read the header
+                size_t length = reader.readLine(line, sizeof(line));
+                log_trace("> %s", line);
+                headerLines++;
+                if (firstLine && length > 0) { // first line
+                    const char* space = strchr(line, ' ');
+                    statusCode = space != NULL ? atoi(space + 1) : 0;
                     firstLine = false;
                 }
-                else if (!firstLine && line.equals("Transfer-Encoding: chunked")) {
+                else if (!firstLine && strcmp(line, "Transfer-Encoding: chunked") == 0) {
                     isChunked = true;
                 }
-                else if (statusCode > 0 && line.length() == 0) { // End of the header
+                else if (!firstLine && strncmp(line, "Content-Type: " MESSAGEPACK_CONTENT_TYPE, 14 + strlen(MESSAGEPACK_CONTENT_TYPE)) == 0) {
+                    isBinary = true;
+                    _serverMessagePack = true;
+                }
+                else if (!firstLine && strcmp(line, "Content-Encoding: gzip") == 0) {
+                    encoding = InflateGzip;
+                }
+                else if (!firstLine && strcmp(line, "Content-Encoding: deflate") == 0) {
+                    encoding = InflateZlib;
+                }
+                else if (statusCode > 0 && length == 0) { // End of the header
                     isBody = true;
+                    _trace.record(TraceResponseHeader, statusCode, headerLines);
+                    if(statusCode != HTTP_OK || isBinary) {
+                        sink.stream = NULL;
+                    }
+                    if(encoding != InflateRaw && response != NULL && _inflater != NULL && !_inflating) {
+                        _inflater->begin(encoding, &sink);
+                        body = _inflater;
+                        _inflating = true;
+                    }
+                    else if(encoding != InflateRaw && response != NULL) {
+                        log_error("Unexpected compressed response");
+                    }
                 }
             }
             else {
@@ -299,7 +737,7 @@ class Constellation
                     break;
                 }
                 if (!isChunked) {
-                    response->concat((char)client->read());
+                    bodyLength += reader.readTo(*body, (size_t)-1);
                 }
                 else {
                     while(true) {
@@ -307,26 +745,22 @@ class Constellation
                             log_error("Connection lost while reading the chunked response");
                             break; 
                         }
-                        line = client->readStringUntil('\n');
-                        if(line.length() <= 0) {
+                        if(reader.readLine(line, sizeof(line)) <= 0) {
                             break;
                         }
-                        line.trim();
                         // read size of chunk
-                        long chunckLength = strtol((const char *) line.c_str(), NULL, 16);
+                        long chunckLength = strtol(line, NULL, 16);
                         log_trace("chunckLength: %d", chunckLength);
                         // data left?
                         if(chunckLength > 0) {
-                            for (long i = 0; client->available() && i < chunckLength; ++i) {
-                                response->concat((char)client->read());
+                            for (size_t count = 0; chunckLength > 0 && (count = reader.readTo(*body, chunckLength)) > 0; chunckLength -= count) {
+                                bodyLength += count;
                             }
                         } else {
                              break;                           
                         }
                         // read trailing \r\n at the end of the chunk
-                        char buf[2];
-                        auto trailing_seq_len = client->readBytes((uint8_t*)buf, 2);
-                        if (trailing_seq_len != 2 || buf[0] != '\r' || buf[1] != '\n') {
+                        if (!reader.skip("\r\n")) {
                             log_debug("Reading timeout");
                             break;
                         }
@@ -335,130 +769,792 @@ class Constellation
                 }
             }
         }
+        if(sink.truncated) {
+            log_error("The response is too large and has been truncated");
+        }
+        if(body != &sink) {
+            _inflating = false;
+            if(!_inflater->finished()) {
+                // ex: a server compressing with a larger window than the inflater's : ask for uncompressed responses from now on
+                log_error("Unable to decode the compressed response : %s. Compression disabled", _inflater->error() ? _inflater->error() : "truncated");
+                _trace.record(TraceDecodeError);
+                delete _inflater;
+                _inflater = NULL;
+                statusCode = HTTP_DECODE_ERROR;
+            }
+        }
+        if(isBody) {
+            _trace.record(TraceResponseBody, (sink.truncated ? 1 : 0) | (isBinary ? 2 : 0) | (body != &sink ? 4 : 0), bodyLength);
+        }
         log_trace("HTTP response code: %d", statusCode);
-        if(response != NULL) {
+        if(response != NULL && !isBinary) {
             log_debug("Raw message: %s", response->c_str());
         }
+        if(isMessagePack != NULL) {
+            *isMessagePack = isBinary;
+        }
         return statusCode;
     };    
-    String urlEncode(const char* msg) {
+    void urlEncode(Print& out, const char* msg) {
         // Unreserved Characters = ALPHA / DIGIT / "-" / "." / "_" / "~"
         // http://www.ietf.org/rfc/rfc3986.txt
-        const char *hex = "0123456789abcdef"; 
-        String encodedMsg = "";
-        while (*msg!='\0'){
-            if( ('a' <= *msg && *msg <= 'z')
-                    || ('A' <= *msg && *msg <= 'Z')
-                    || ('0' <= *msg && *msg <= '9') 
-                    || *msg == '-' || *msg == '.' || *msg == '_' || *msg == '~' || *msg == '*' ) {
-                encodedMsg += *msg;
-            } else {
-                encodedMsg += '%';
-                encodedMsg += hex[*msg >> 4];
-                encodedMsg += hex[*msg & 15];
-            }
-            msg++;
-        }
-        return encodedMsg;
+        // The runs of unreserved characters are written at once, the other bytes (UTF-8 included) as %XX
+        const char *hex = "0123456789abcdef";
+        while (*msg != '\0') {
+            size_t run = unreservedSpan(msg);
+            if (run > 0) {
+                out.write((const uint8_t*)msg, run);
+                msg += run;
+            }
+            if (*msg != '\0') {
+                uint8_t c = (uint8_t)*msg++;
+                const char escaped[3] = { '%', hex[c >> 4], hex[c & 15] };
+                out.write((const uint8_t*)escaped, sizeof(escaped));
+            }
+        }
+    };
+    // The heap-free responses are parsed in place (zero-copy), the Strings are duplicated by ArduinoJson
+    template<size_t CAPACITY>
+    static char* parsableJson(FixedString<CAPACITY>& json) {
+        return json.begin();
+    };
+    static const String& parsableJson(String& json) {
+        return json;
     };
 
+    // Decodes a MessagePack response in place
+    static JsonArray& parseMessagePackArray(ResponseString& response, JsonBuffer& jsonBuffer) {
+        MessagePackReader reader((uint8_t*)response.begin(), response.length());
+        JsonVariant root = reader.toJson(jsonBuffer);
+        return reader.error() ? JsonArray::invalid() : root.as<JsonArray&>();
+    };
+#if defined(ESP32) && defined(CONSTELLATION_NETWORK_TASK)
+    // Shared by the instances, as the buffers (recursive : a request sent with the formatted text can format a log)
+    static std::recursive_mutex& formatMutex() {
+        static std::recursive_mutex mutex;
+        return mutex;
+    };
+    static std::mutex& logMutex() {
+        static std::mutex mutex;
+        return mutex;
+    };
+#endif
+    // The caller holds CONSTELLATION_FORMAT_LOCK while the result is used
     const char* stringFormat(const char* format, va_list myargs) {
-        static char result[STRING_FORMAT_BUFFER];
-        vsnprintf(result, STRING_FORMAT_BUFFER, format, myargs);
+        static CONSTELLATION_THREAD_LOCAL char result[TProfile::StringFormatBufferSize];
+        vsnprintf(result, TProfile::StringFormatBufferSize, format, myargs);
         return result;
     };
     const char* stringFormat(const char* format, ...) {
-        static char result[STRING_FORMAT_BUFFER];
         va_list myargs;
         va_start(myargs, format);
-        vsnprintf(result, STRING_FORMAT_BUFFER, format, myargs);
+        const char* result = stringFormat(format, myargs);
         va_end(myargs);
         return result;
     };
 
+    // 'message' is in flash on AVR & ESP8266 (see the log_* macros)
     void log(const char* message, va_list myargs, DebugMode level) {
         if (Serial && this->_debugMode >= (int8_t)level) {
             switch(level) {
                 case 1:
-                    Serial.print("[ERROR] ");
+                    Serial.print(F("[ERROR] "));
                     break;
                 case 2:
-                    Serial.print("[INFO] ");
+                    Serial.print(F("[INFO] "));
                     break;
                 case 3:
-                    Serial.print("[DEBUG] ");
+                    Serial.print(F("[DEBUG] "));
                     break;
                 case 4:
-                    Serial.print("[TRACE] ");
+                    Serial.print(F("[TRACE] "));
                     break;
                 default:
                     break;
             }            
-            static char internal_log[STRING_FORMAT_BUFFER];
-            vsnprintf(internal_log, STRING_FORMAT_BUFFER, message, myargs);
+            CONSTELLATION_LOG_LOCK;
+            static CONSTELLATION_THREAD_LOCAL char internal_log[TProfile::LogBufferSize];
+            CONSTELLATION_VSNPRINTF(internal_log, TProfile::LogBufferSize, message, myargs);
             Serial.println(internal_log);
         }
     }
-    void log_error(const char* message, ...) {
-        if (this->_debugMode >= (int8_t)Error && Serial) {
+    void logMessage(DebugMode level, const char* message, ...) {
+        if (this->_debugMode >= (int8_t)level && Serial) {
             va_list myargs;
             va_start(myargs, message);
-            log(message, myargs, Error);
+            log(message, myargs, level);
             va_end(myargs);
         }
     }
-    void log_info(const char* message, ...) {
-        if (this->_debugMode >= (int8_t)Info && Serial) {
-            va_list myargs;
-            va_start(myargs, message);
-            log(message, myargs, Info);
-            va_end(myargs);
+
+    void beginRenewal(RenewalState& renewal) {
+        if(renewal.index < 0) {
+            renewal.index = 0;
+            renewal.backoff = 0;
+            renewal.nextAttempt = millis();
         }
     }
-    void log_debug(const char* message, ...) {
-        if (this->_debugMode >= (int8_t)Debug && Serial) {
-            va_list myargs;
-            va_start(myargs, message);
-            log(message, myargs, Debug);
-            va_end(myargs);
+    bool advanceRenewal(RenewalState& renewal, bool success, int count) {
+        if(success) {
+            renewal.backoff = 0;
+            if(++renewal.index >= count) {
+                renewal.index = -1;
+                log_info("Subscriptions renewed");
+            }
+        }
+        else {
+            // Exponential backoff with jitter so that devices don't hammer a restarting server in lockstep
+            renewal.backoff = renewal.backoff == 0 ? RENEW_BACKOFF_MIN : (renewal.backoff >= RENEW_BACKOFF_MAX / 2 ? RENEW_BACKOFF_MAX : renewal.backoff * 2);
+            long wait = renewal.backoff / 2 + random(renewal.backoff / 2 + 1);
+            renewal.nextAttempt = millis() + wait;
+            log_debug("Next renewal attempt in %ld ms", wait);
         }
+        return renewal.index >= 0;
     }
-    void log_trace(const char* message, ...) {
-        if (this->_debugMode >= (int8_t)Trace && Serial) {
-            va_list myargs;
-            va_start(myargs, message);
-            log(message, myargs, Trace);
-            va_end(myargs);
+    // Renew the message subscription then each group, one request per call. Returns true while the renewal is in progress.
+    bool renewMessageSubscriptions() {
+        if(_msgRenewal.index < 0) {
+            return false;
         }
+        if((long)(millis() - _msgRenewal.nextAttempt) < 0) {
+            return true;
+        }
+        bool success;
+        if(_msgRenewal.index == 0) {
+            log_debug("Renew the message subscription");
+            success = subscribeToMessage(true);
+            if(!success) {
+                log_error("Unable to renew the message subscription");
+            }
+        }
+        else {
+            const char* group = _msgGroups.get(_msgRenewal.index - 1);
+            log_debug("Renew subscription for the group %s", group);
+            success = subscribeToGroup(group, true);
+            if(!success) {
+                log_error("Unable to renew the subscription for the group %s", group);
+            }
+        }
+        return advanceRenewal(_msgRenewal, success, 1 + _msgGroups.size());
+    }
+    // Renew each StateObject subscription, one request per call. Returns true while the renewal is in progress.
+    bool renewStateObjectSubscriptions() {
+        if(_soRenewal.index < 0) {
+            return false;
+        }
+        if((long)(millis() - _soRenewal.nextAttempt) < 0) {
+            return true;
+        }
+        bool success = true;
+        if(_soRenewal.index < _soCallbacks.size()) {
+            StateObjectSubscription subcription = _soCallbacks.get(_soRenewal.index);
+            log_debug("Renew the subscription for the StateObjects %s/%s/%s/%s", subcription.sentinel, subcription.package, subcription.name, subcription.type);
+            success = subscribeToStateObjects(subcription.sentinel, subcription.package, subcription.name, subcription.type);
+            if(!success) {
+                log_error("Unable to renew the subscription for the StateObjects %s/%s/%s/%s", subcription.sentinel, subcription.package, subcription.name, subcription.type);
+            }
+        }
+        return advanceRenewal(_soRenewal, success, _soCallbacks.size());
     }
 
-    void renewSubscriptions() {
-        log_debug("Renew the message subscription");
-        if(!subscribeToMessage(true)) {
-            log_error("Unable to renew the message subscription");
+    // Fills the context in a single pass over the message (rather than a key lookup for each field)
+    static void readMessageContext(JsonObject& message, MessageContext& ctx, JsonVariant* data = NULL) {
+        memset(&ctx, 0, sizeof(ctx));
+        for(JsonPair& pair : message) {
+            if(strcmp(pair.key, "Key") == 0) {
+                ctx.messageKey = pair.value.as<char *>();
+            }
+            else if(data != NULL && strcmp(pair.key, "Data") == 0) {
+                *data = pair.value;
+            }
+            else if(strcmp(pair.key, "Scope") == 0) {
+                for(JsonPair& scope : pair.value.as<JsonObject&>()) {
+                    if(strcmp(scope.key, "SagaId") == 0) {
+                        ctx.sagaId = scope.value.as<char *>();
+                    }
+                    else if(strcmp(scope.key, "Scope") == 0) {
+                        ctx.scope = (ScopeType)scope.value.as<uint8_t>();
+                    }
+                }
+            }
+            else if(strcmp(pair.key, "Sender") == 0) {
+                for(JsonPair& sender : pair.value.as<JsonObject&>()) {
+                    if(strcmp(sender.key, "Type") == 0) {
+                        ctx.sender.type = (SenderType)sender.value.as<uint8_t>();
+                    }
+                    else if(strcmp(sender.key, "FriendlyName") == 0) {
+                        ctx.sender.friendlyName = sender.value.as<char *>();
+                    }
+                    else if(strcmp(sender.key, "ConnectionId") == 0) {
+                        ctx.sender.connectionId = sender.value.as<char *>();
+                    }
+                }
+            }
+        }
+        ctx.isSaga = ctx.sagaId != NULL;
+    };
+    void dispatchMessage(JsonObject& message) {
+        if(!_msgCallback && !_msgCallbackWithContext && _msgCallbacks.size() == 0) {
             return;
         }
-        if(_msgGroups.size() > 0) {
-            for(int i = 0; i < _msgGroups.size(); i++) {
-                const char* group = _msgGroups.get(i);
-                log_debug("Renew subscription for the group %s", group);
-                if(!subscribeToGroup(group, true)) {
-                    log_error("Unable to renew the subscription for the group %s", group);
-                    return;
+        MessageContext ctx;
+        JsonVariant data;
+        readMessageContext(message, ctx, &data);
+        log_debug("Receiving message %s from %s", ctx.messageKey, ctx.sender.friendlyName);
+        if(_trace.enabled()) {
+            _trace.record(TraceMessage, 0, ctx.messageKey ? fnv1a(ctx.messageKey) : 0);
+        }
+        if(_msgCallback) {
+            log_debug("Invoking MessageReceiveCallback registered without context");
+            _msgCallback(message);
+        }
+        if(_msgCallbackWithContext) {
+            log_debug("Invoking MessageReceiveCallback registered with context");
+            _msgCallbackWithContext(message, ctx);
+        }
+        for(int j = 0; j < _msgCallbacks.size(); j++) {
+            // No copy in heap-free mode (the descriptor can be large)
+            const MessageCallbackSubscription& mc = _msgCallbacks.get(j);
+            const char* id = mc.isSagaCallback ? mc.sagaId : mc.id;
+            if (id && (mc.msgCallback || mc.msgCallbackWithContext || mc.typedInvoker) &&
+                (mc.isSagaCallback ? ctx.sagaId != NULL : ctx.messageKey != NULL) &&
+                strcmp (mc.isSagaCallback ? ctx.sagaId : ctx.messageKey, id) == 0) {
+                if(mc.msgCallback) {
+                    log_debug("Invoking MessageCallback '%s' without context", id);
+                    mc.msgCallback(message);
+                }
+                if(mc.msgCallbackWithContext) {
+                    log_debug("Invoking MessageCallback '%s' with context", id);
+                    mc.msgCallbackWithContext(message, ctx);
                 }
+                // The descriptor accessors aren't const
+                if(mc.typedInvoker && !mc.typedInvoker(data, const_cast<MessageCallbackDescriptor&>(mc.descriptor), mc.typedCallback, mc.typedWithContext ? &ctx : NULL)) {
+                    log_error("Invalid arguments for the MessageCallback '%s'", id);
+                }
+                if(mc.isSagaCallback) {
+                    // remove the saga callback
+                    _msgCallbacks.remove(j--);
+                }
+            }
+        }
+    };
+    // Reads the response of the long-poll (if any) & sends the next one
+    void pollMessages(int timeout, int limit) {
+        if(this->_msgSubscriptionId != NULL) {
+            if(renewMessageSubscriptions()) {
+                return;
+            }
+            // A connection without pending long-poll (ex: opened by warmUp, or the poll deferred) gets its request below
+            if((_msgPollPending && _netClientMsg.connected() && !_netClientMsg.available()) || _readingItems) {
+                return;     // nothing new, or called by a callback of the items being read (their buffer is in use)
             }
-         }
-        if(_soCallbacks.size() > 0) {
-            for(int i = 0; i < _soCallbacks.size(); i++) {
-                StateObjectSubscription subcription = _soCallbacks.get(i);
-                log_debug("Renew the subscription for the StateObjects %s/%s/%s/%s", subcription.sentinel, subcription.package, subcription.name, subcription.type);
-                if(!subscribeToStateObjects(subcription.sentinel, subcription.package, subcription.name, subcription.type)) {
-                    log_error("Unable to renew the subscription for the StateObjects %s/%s/%s/%s", subcription.sentinel, subcription.package, subcription.name, subcription.type);
+            else if (_netClientMsg.available()) {
+                // Read the response (the messages are queued, or dispatched, as they are read)
+                int statusCode = readItems(&_netClientMsg, _msgResponse, false);
+                _msgPollPending = false;
+                if(statusCode == HTTP_SERVER_ERROR) {
+                    log_error("Unable to get messages : internal server error");
+                    // Renew in the background, the long-poll will be re-armed once the subscriptions are confirmed
+                    beginRenewal(_msgRenewal);
+                    _netClientMsg.stop();
                     return;
                 }
             }
-         }
-    }
+            // Do request, once there's room for the next messages
+            limit = incomingLimit(limit);
+            if(limit == 0) {
+                _msgPollPending = false;
+                return;
+            }
+            char strTimeout[12], strLimit[12];
+            snprintf(strTimeout, sizeof(strTimeout), "%d", timeout);
+            snprintf(strLimit, sizeof(strLimit), "%d", limit);
+            const char* args[] = { "subscriptionId", this->_msgSubscriptionId,  "timeout", strTimeout, "limit", strLimit };
+            _msgPollPending = writeRequest(&_netClientMsg, "GetMessages", args, 3, true);
+        }
+        else {
+            log_trace("checkIncomingMessage : no SubcriptionId");
+        }
+    };
+    // Reads a GetMessages or GetStateObjects response : a JSON array is split & each item dispatched as soon as it's read
+    // (the memory needed is set by the largest item), a MessagePack array is decoded once read.
+    int readItems(TNetworkClass* client, ResponseString& response, bool isStateObject) {
+        response = "";
+        StreamTarget target = { this, isStateObject };
+        JsonArraySplitter splitter(_incomingItem, sizeof(_incomingItem), onStreamedItem, &target);
+        bool isMessagePack;
+        _readingItems = true;
+        int statusCode = readResponse(client, &response, &isMessagePack, &splitter);
+        _readingItems = false;
+        if(statusCode == HTTP_OK) {
+            if(isMessagePack) {
+                StaticJsonBuffer<TProfile::JsonParserBufferSize> jsonBuffer;
+                JsonArray& array = parseMessagePackArray(response, jsonBuffer);
+                if (!array.success()) {
+                    log_error("Unable to parse the incoming %s", isStateObject ? "StateObjects" : "messages");
+                }
+                for(int i = 0; i < array.size(); i++) {
+                    JsonObject& item = array[i];
+                    if(!isStateObject && _dedup.messagesEnabled()) {
+                        HashPrint fingerprint;
+                        item.printTo(fingerprint);
+                        if(isDuplicateMessage(fingerprint.hash())) {
+                            continue;
+                        }
+                    }
+                    dispatchItem(item, isStateObject);
+                }
+            }
+            if(splitter.dropped() > 0) {
+                log_error("%d incoming %s too large : dropped", splitter.dropped(), isStateObject ? "StateObject(s)" : "message(s)");
+                _trace.record(TraceItemDropped, isStateObject, splitter.dropped());
+            }
+        }
+        return statusCode;
+    };
+    static void onStreamedItem(void* context, char* json, size_t length) {
+        StreamTarget* target = (StreamTarget*)context;
+        target->owner->dispatchItem(json, length, target->isStateObject);
+    };
+    void dispatchItem(char* json, size_t length, bool isStateObject) {
+        if(!isStateObject && _dedup.messagesEnabled() && isDuplicateMessage(fnv1a((const uint8_t*)json, length))) {
+            return;
+        }
+#ifdef CONSTELLATION_NETWORK_TASK
+        if(isNetworkTaskStarted()) {
+            enqueueInbound(json, length, isStateObject);
+            return;
+        }
+#endif
+        char* record;
+        if(!isStateObject && (record = reserveQueuedMessage(length)) != NULL) {
+            memcpy(record, json, length + 1);
+            _inboundRing.commit();
+            return;
+        }
+        StaticJsonBuffer<TProfile::JsonParserBufferSize> jsonBuffer;
+        JsonObject& item = jsonBuffer.parseObject(json);
+        if (!item.success()) {
+            log_error("Unable to parse the incoming %s", isStateObject ? "StateObject" : "message");
+            return;
+        }
+        dispatchItem(item, isStateObject);
+    };
+    void dispatchItem(JsonObject& item, bool isStateObject) {
+#ifdef CONSTELLATION_NETWORK_TASK
+        if(isNetworkTaskStarted()) {
+            enqueueInbound(item, isStateObject);
+            return;
+        }
+#endif
+        char* record;
+        if(!isStateObject && (record = reserveQueuedMessage(item.measureLength())) != NULL) {
+            item.printTo(record, item.measureLength() + 1);
+            _inboundRing.commit();
+            return;
+        }
+        if(isStateObject) {
+            dispatchStateObject(item);
+        }
+        else {
+            dispatchMessage(item);
+        }
+    };
+    // Message delivered again (after a renewal or a lost response) : the same JSON received during the last DedupWindow ms
+    bool isDuplicateMessage(uint32_t fingerprint) {
+        if(!_dedup.isDuplicateMessage(fingerprint, TProfile::DedupWindow)) {
+            return false;
+        }
+        log_debug("Duplicate message dropped");
+        _trace.record(TraceDuplicate, 0, fingerprint);
+        return true;
+    };
+    // Room for an incoming message in the inbound ring, NULL if it's disabled or too small. When it's full,
+    // the queued messages are dispatched first (whatever the budget) to keep the order.
+    char* reserveQueuedMessage(size_t length) {
+        if(!_inboundRing.enabled()) {
+            return NULL;
+        }
+        char* record;
+        while((record = _inboundRing.reserve(length)) == NULL && dispatchQueuedMessage());
+        return record;
+    };
+    bool dispatchQueuedMessage() {
+        char* json = _inboundRing.front();
+        if(json == NULL || _dispatching) {
+            return false;   // a callback of a queued message is running : the next ones wait for it
+        }
+        _dispatching = true;
+        StaticJsonBuffer<TProfile::JsonParserBufferSize> jsonBuffer;
+        JsonObject& message = jsonBuffer.parseObject(json);
+        if (message.success()) {
+            dispatchMessage(message);
+        }
+        else {
+            log_error("Unable to parse the incoming message");
+        }
+        _inboundRing.release();
+        _dispatching = false;
+        return true;
+    };
+    // Dispatches the queued messages within the budget of setDispatchBudget (at least one per call)
+    void dispatchQueuedMessages() {
+        unsigned long start = millis();
+        for(int dispatched = 0; withinDispatchBudget(dispatched, start) && dispatchQueuedMessage(); dispatched++);
+    };
+    bool withinDispatchBudget(int dispatched, unsigned long start) {
+        return dispatched == 0 || ((_dispatchMaxCount == 0 || dispatched < _dispatchMaxCount) && (_dispatchMaxTime == 0 || millis() - start < _dispatchMaxTime));
+    };
+    // Backpressure : the next long-poll asks for no more messages than there is room for (0 : it waits)
+    int incomingLimit(int limit) {
+        size_t room = limit;
+#ifdef CONSTELLATION_NETWORK_TASK
+        if(isNetworkTaskStarted()) {
+            room = TProfile::NetworkQueueLength - _networkTask->inbound.size();
+        }
+        else
+#endif
+        if(_inboundRing.enabled()) {
+            room = _inboundRing.room();
+        }
+        if(room < (size_t)limit) {
+            log_debug("Messages limit reduced to %d", (int)room);
+            return room;
+        }
+        return limit;
+    };
+    void dispatchStateObject(JsonObject& item) {
+        if(!_soCallback && _soCallbacks.size() == 0 && !_soCache.enabled() && !_trace.enabled()) {
+            return;
+        }
+        JsonObject& stateObject = item["StateObject"];
+        // Identity of the StateObject in a single pass
+        const char * sentinel = NULL;
+        const char * package = NULL;
+        const char * name = NULL;
+        const char * type = NULL;
+        const char * lastUpdate = NULL;
+        if(_soCallbacks.size() > 0 || _soCache.enabled() || _trace.enabled() || _dedup.stateObjectsEnabled()) {
+            for(JsonPair& pair : stateObject) {
+                if(strcmp(pair.key, "SentinelName") == 0) {
+                    sentinel = pair.value.as<char *>();
+                }
+                else if(strcmp(pair.key, "PackageName") == 0) {
+                    package = pair.value.as<char *>();
+                }
+                else if(strcmp(pair.key, "Name") == 0) {
+                    name = pair.value.as<char *>();
+                }
+                else if(strcmp(pair.key, "Type") == 0) {
+                    type = pair.value.as<char *>();
+                }
+                else if(strcmp(pair.key, "LastUpdate") == 0) {
+                    lastUpdate = pair.value.as<char *>();
+                }
+            }
+        }
+        // Update delivered again (after a renewal or a lost response) : same LastUpdate as the last one dispatched
+        if(_dedup.stateObjectsEnabled() && sentinel && package && name && lastUpdate &&
+            _dedup.isDuplicateStateObject(fnv1a(name, fnv1a(package, fnv1a(sentinel))), fnv1a(lastUpdate))) {
+            log_debug("Duplicate StateObject %s/%s/%s dropped", sentinel, package, name);
+            _trace.record(TraceDuplicate, 1, fnv1a(name));
+            return;
+        }
+        if(_trace.enabled()) {
+            _trace.record(TraceStateObject, 0, name ? fnv1a(name) : 0);
+        }
+        // Update the local copy before the callbacks
+        if(_soCache.enabled() && sentinel && package && name && !_soCache.update(sentinel, package, name, stateObject)) {
+            log_debug("The StateObject %s/%s/%s is too large for the cache", sentinel, package, name);
+        }
+        if(_soCallback) {
+            log_debug("Invoking StateObject Callback");
+            _soCallback(stateObject);
+        }
+        for(int j = 0; j < _soCallbacks.size(); j++) {
+            StateObjectSubscription subcription = _soCallbacks.get(j);
+            if( (strcmp (WILDCARD, subcription.sentinel) == 0 || (sentinel && strcmp (sentinel, subcription.sentinel) == 0)) &&
+                (strcmp (WILDCARD, subcription.package) == 0 || (package && strcmp (package, subcription.package) == 0)) &&
+                (strcmp (WILDCARD, subcription.name) == 0 || (name && strcmp (name, subcription.name) == 0)) &&
+                (strcmp (WILDCARD, subcription.type) == 0 || (type && strcmp (type, subcription.type) == 0))) {
+                log_debug("Invoking StateObjectLink registered for %s/%s/%s/%s", subcription.sentinel, subcription.package, subcription.name, subcription.type);
+                subcription.soCallback(stateObject);
+            }
+        }
+    };
+    void resetDeltaPublisher(const char* name) {
+#ifdef CONSTELLATION_NETWORK_TASK
+        std::lock_guard<std::mutex> deltaLock(_deltaMutex);
+#endif
+        _deltaPublisher.reset(name);
+    };
+    bool isNetworkTaskStarted() {
+#ifdef CONSTELLATION_NETWORK_TASK
+        return _networkTask != NULL;
+#else
+        return false;
+#endif
+    };
+#ifdef CONSTELLATION_NETWORK_TASK
+    // Once the network task is started, the requests of the application are queued and sent by the network task
+    bool isQueuingRequests() {
+        if(_networkTask == NULL) {
+            return false;
+        }
+#ifdef ESP32
+        return _networkTask->owner.load() != xTaskGetCurrentTaskHandle();
+#else
+        return _networkTask->owner.load() != std::this_thread::get_id();
+#endif
+    };
+    // Messages (saga responses included) must not wait behind the telemetry
+    static OutboundLane outboundLane(const char* method) {
+        return strcmp(method, "SendMessage") == 0 ? OutboundInteractive : OutboundBulk;
+    };
+    OutboundSlot* reserveOutbound(const char* method, OutboundLane lane, ResponseString* response) {
+        if(response != NULL) {
+            log_error("%s needs a response : not available once the network task is started", method);
+            return NULL;
+        }
+        OutboundSlot* slot = lane == OutboundInteractive ? _networkTask->interactive.reserve() : _networkTask->bulk.reserve();
+        if(slot == NULL) {
+            _networkTask->laneDropped[lane]++;
+            log_error("The outbound queue is full : %s dropped", method);
+            return NULL;
+        }
+        *slot = "";
+        return slot;
+    };
+    int commitOutbound(OutboundSlot* slot, OutboundLane lane, const char* method) {
+        bool tooLarge = slot->length() >= TProfile::OutboundSlotSize - 1;
+        if(tooLarge) {
+            log_error("The request %s is too large for the outbound queue", method);
+            *slot = ""; // the reserved slot is published empty and skipped by the network task
+        }
+        slot->queuedAt = millis();
+        if(lane == OutboundInteractive) {
+            _networkTask->interactive.commit(slot);
+        }
+        else {
+            _networkTask->bulk.commit(slot);
+        }
+        return tooLarge ? 0 : HTTP_NO_CONTENT;
+    };
+    // Network task : copies an incoming item in the next inbound slot and parses it there
+    InboundSlot* reserveInbound() {
+        InboundSlot* slot;
+        while((slot = _networkTask->inbound.reserve()) == NULL) {
+            if(_networkTask->stopping) {
+                return NULL;
+            }
+            delay(1); // the application is late to dispatch
+        }
+        return slot;
+    };
+    void enqueueInbound(JsonObject& item, bool isStateObject) {
+        InboundSlot* slot = reserveInbound();
+        if(slot == NULL) {
+            return;
+        }
+        if(item.measureLength() >= sizeof(slot->json)) {
+            log_error("The incoming %s is too large for the inbound queue", isStateObject ? "StateObject" : "message");
+            return;
+        }
+        item.printTo(slot->json, sizeof(slot->json));
+        commitInbound(slot, isStateObject);
+    };
+    void enqueueInbound(const char* json, size_t length, bool isStateObject) {
+        InboundSlot* slot = reserveInbound();
+        if(slot == NULL) {
+            return;
+        }
+        if(length >= sizeof(slot->json)) {
+            log_error("The incoming %s is too large for the inbound queue", isStateObject ? "StateObject" : "message");
+            return;
+        }
+        memcpy(slot->json, json, length + 1);
+        commitInbound(slot, isStateObject);
+    };
+    void commitInbound(InboundSlot* slot, bool isStateObject) {
+        slot->jsonBuffer.clear();
+        slot->root = &slot->jsonBuffer.parseObject(slot->json);
+        if(!slot->root->success()) {
+            log_error("Unable to parse the incoming %s", isStateObject ? "StateObject" : "message");
+            return;
+        }
+        slot->isStateObject = isStateObject;
+        _networkTask->inbound.commit();
+    };
+    // Application : invokes the callbacks for the items parsed by the network task
+    void dispatchInbound() {
+        InboundSlot* slot;
+        unsigned long start = millis();
+        for(int dispatched = 0; withinDispatchBudget(dispatched, start) && (slot = _networkTask->inbound.front()) != NULL; dispatched++) {
+            if(slot->isStateObject) {
+                dispatchStateObject(*slot->root);
+            }
+            else {
+                dispatchMessage(*slot->root);
+            }
+            _networkTask->inbound.release();
+        }
+    };
+    // Network task : next request to send, the interactive lane first. A bulk request queued for more than
+    // OutboundAgingLimit takes turns with the interactive ones, so a steady flow of messages can't starve the telemetry.
+    OutboundSlot* nextOutbound(OutboundLane& lane) {
+        OutboundSlot* interactive = _networkTask->interactive.front();
+        OutboundSlot* bulk = _networkTask->bulk.front();
+        if(bulk != NULL && (interactive == NULL || (!_networkTask->bulkPromoted && millis() - bulk->queuedAt >= TProfile::OutboundAgingLimit))) {
+            _networkTask->bulkPromoted = interactive != NULL;
+            if(interactive != NULL) {
+                _networkTask->laneStats[OutboundBulk].promoted++;
+            }
+            lane = OutboundBulk;
+            return bulk;
+        }
+        _networkTask->bulkPromoted = false;
+        lane = OutboundInteractive;
+        return interactive;
+    };
+    // Network task : sends the queued requests, one at a time so a new interactive request goes ahead of the queued bulk ones
+    void sendOutbound() {
+        OutboundLane lane;
+        OutboundSlot* slot;
+        while((slot = nextOutbound(lane)) != NULL) {
+            if(slot->length() > 0) {
+                sendQueuedRequest(*slot, lane);
+            }
+            if(lane == OutboundInteractive) {
+                _networkTask->interactive.release();
+            }
+            else {
+                _networkTask->bulk.release();
+            }
+        }
+    };
+    void sendQueuedRequest(OutboundSlot& slot, OutboundLane lane) {
+        if(!openClient(&_netClient, "queued", "request", NULL)) {
+            _networkTask->laneDropped[lane]++;
+            return;
+        }
+        _trace.record(TraceRequest, 'Q', slot.length());
+        _netClient.write((const uint8_t*)slot.c_str(), slot.length());
+        int statusCode = readResponse(&_netClient, NULL);
+        if(statusCode == 0) {
+            _netClient.stop();
+        }
+        else {
+            _netClientLastUsed = millis();
+        }
+        if(statusCode >= 300 || statusCode == 0) {
+            log_error("Incorrect response for a queued request: %d", statusCode);
+        }
+        OutboundLaneStats& stats = _networkTask->laneStats[lane];
+        stats.sent++;
+        stats.lastLatency = millis() - slot.queuedAt;
+        stats.totalLatency += stats.lastLatency;
+        if(stats.lastLatency > stats.maxLatency) {
+            stats.maxLatency = stats.lastLatency;
+        }
+    };
+    void runNetworkTask() {
+#ifdef ESP32
+        _networkTask->owner = xTaskGetCurrentTaskHandle();
+#else
+        _networkTask->owner = std::this_thread::get_id();
+#endif
+        while(!_networkTask->stopping) {
+            checkIncomingMessage(_networkTask->timeout, _networkTask->limit);
+            checkStateObjectUpdate(_networkTask->timeout, _networkTask->limit);
+            sendOutbound();
+            delay(1);
+        }
+#ifdef ESP32
+        _networkTask->stopped = true;
+        vTaskDelete(NULL);
+#endif
+    };
+    static void networkTaskEntry(void* constellation) {
+        ((Constellation*)constellation)->runNetworkTask();
+    };
+#endif
+    bool sendStateObject(const char* name, JsonVariant value, const char* type, JsonObject* metadatas, int lifetime, bool checkDelta) {
+        JsonWriterBuffer jsonBuffer;
+        JsonObject& stateObject = jsonBuffer.createObject();
+        stateObject["Name"] = name;
+        bool isRawJson = false;
+        if(value.is<const char*>() || value.is<char*>()) {
+            const char * strValue = value.as<const char*>();
+             if (strValue[0] == '{' || strValue[0] == '[') {
+                value = RawJson(strValue);
+                isRawJson = true;
+             }
+        }
+        stateObject["Value"] = value;
+        if(type == NULL) {
+            if(value.is<bool>()) {
+                stateObject["Type"] = "System.Boolean";
+            }
+            else if(value.is<float>()) {
+                stateObject["Type"] = "System.Float";
+            }
+            else if(value.is<double>()) {
+                stateObject["Type"] = "System.Double";
+            }
+            else if(value.is<signed int>() || value.is<unsigned int>()) {
+                stateObject["Type"] = "System.Int32";
+            }
+            else if(value.is<signed short>() || value.is<unsigned short>()) {
+                stateObject["Type"] = "System.Int16";
+            }
+            else if(value.is<signed long>() || value.is<unsigned long>()) {
+                stateObject["Type"] = "System.Int64";
+            }
+            else if(!isRawJson && (value.is<const char*>() || value.is<char*>())) {
+                stateObject["Type"] = "System.String";
+            }
+            else if(value.is<signed char>() || value.is<unsigned char>()) {
+                stateObject["Type"] = "System.Char";
+            }
+        }
+        else {
+            stateObject["Type"] = type;	
+        }
+        if(lifetime > 0) {
+            stateObject["Lifetime"] = lifetime;
+        }
+        if(metadatas != NULL) {
+            stateObject["Metadatas"] = *metadatas;
+        }
+        // Skip the push if the StateObject has not changed since the last push
+        bool isNumeric = value.is<long>() || value.is<double>();
+        float numericValue = isNumeric ? value.as<float>() : 0;
+        uint32_t hash = 0;
+#ifdef CONSTELLATION_NETWORK_TASK
+        // The publishers can be on several threads : check & update the delta table atomically
+        std::unique_lock<std::mutex> deltaLock(_deltaMutex, std::defer_lock);
+        if(checkDelta) {
+            deltaLock.lock();
+        }
+#endif
+        if(checkDelta) {
+            HashPrint hashPrint;
+            stateObject.printTo(hashPrint);
+            hash = hashPrint.hash();
+            if(!_deltaPublisher.mustPush(name, hash, isNumeric, numericValue, lifetime)) {
+                log_debug("StateObject '%s' unchanged : push skipped", name);
+                return true;
+            }
+        }
+        // MessagePack once the server has shown it supports it (raw JSON values stay in JSON)
+        if(sendPostRequest("PushStateObject", stateObject, NULL, _messagePack && _serverMessagePack && !isRawJson) != HTTP_NO_CONTENT) {
+            return false;
+        }
+        if(checkDelta) {
+            _deltaPublisher.pushed(name, hash, numericValue);
+        }
+        return true;
+    };
 
   public:
     Constellation() { };
@@ -480,156 +1576,122 @@ class Constellation
     const char* getPackageName() {
         return _packageName;
     };
+    // Worst-case RAM used by this instance (including the network clients) and the buffers of its memory profile
+    static size_t getMemoryFootprint() {
+        return sizeof(Constellation) + MemoryFootprint<TProfile>::SharedBuffers + MemoryFootprint<TProfile>::PeakStack;
+    };
     
     void loop() {
-        loop(DEFAULT_SUBSCRIPTION_TIMEOUT, DEFAULT_SUBSCRIPTION_LIMIT);
+        loop(DEFAULT_SUBSCRIPTION_TIMEOUT, TProfile::DefaultSubscriptionLimit);
     };
     void loop(int timeout) {
-        loop(timeout, DEFAULT_SUBSCRIPTION_LIMIT);
+        loop(timeout, TProfile::DefaultSubscriptionLimit);
     };
     void loop(int timeout, int limit) {
+#ifdef CONSTELLATION_NETWORK_TASK
+        if(isNetworkTaskStarted()) {
+            // The network task does the I/O : only dispatch what it received
+            dispatchInbound();
+            runTasks();
+            return;
+        }
+#endif
         checkIncomingMessage(timeout, limit);
+        runTasks();
         checkStateObjectUpdate(timeout, limit);
+        runTasks();
+    };
+#ifdef CONSTELLATION_NETWORK_TASK
+    // Move the network I/O & the JSON parsing in a dedicated task (on the given core on ESP32), once the subscriptions are done.
+    // loop() then only invokes the callbacks & runs the tasks : the requests sent by the application (pushStateObject,
+    // sendMessage, writeLog, ...) are queued and never wait on the network. Requests waiting for a response are no longer available.
+    // On Linux, pushStateObject, sendMessage, sendResponse & writeLog can then be called from several threads (sagas & registrations from loop() only).
+    // Messages & saga responses are queued in their own lane, sent ahead of the StateObjects & logs (see getOutboundStats).
+    bool startNetworkTask(int timeout = DEFAULT_SUBSCRIPTION_TIMEOUT, int limit = TProfile::DefaultSubscriptionLimit) {
+        if(_networkTask != NULL) {
+            return true;
+        }
+        _networkTask = new NetworkTask();
+        _networkTask->stopping = false;
+        _networkTask->timeout = timeout;
+        _networkTask->limit = limit;
+#ifdef ESP32
+        _networkTask->owner = NULL;
+        _networkTask->stopped = false;
+        TaskHandle_t handle;
+        if(xTaskCreatePinnedToCore(networkTaskEntry, "constellation", TProfile::NetworkTaskStackSize, this, 1, &handle, TProfile::NetworkTaskCore) != pdPASS) {
+            log_error("Unable to create the network task");
+            delete _networkTask;
+            _networkTask = NULL;
+            return false;
+        }
+#else
+        _networkTask->thread = std::thread(networkTaskEntry, this);
+#endif
+        log_info("Network task started");
+        return true;
+    };
+    void stopNetworkTask() {
+        if(_networkTask == NULL) {
+            return;
+        }
+        _networkTask->stopping = true;
+#ifdef ESP32
+        while(!_networkTask->stopped) {
+            delay(1);
+        }
+#else
+        _networkTask->thread.join();
+#endif
+        delete _networkTask;
+        _networkTask = NULL;
     };
+#endif
+
     void checkIncomingMessage() {
-        checkIncomingMessage(DEFAULT_SUBSCRIPTION_TIMEOUT, DEFAULT_SUBSCRIPTION_LIMIT);
+        checkIncomingMessage(DEFAULT_SUBSCRIPTION_TIMEOUT, TProfile::DefaultSubscriptionLimit);
     };
     void checkIncomingMessage(int timeout) {
-        checkIncomingMessage(timeout, DEFAULT_SUBSCRIPTION_LIMIT);
+        checkIncomingMessage(timeout, TProfile::DefaultSubscriptionLimit);
     };
+    // Reads the messages received & re-arms the long-poll, then dispatches the queued messages (see setDispatchBudget)
     void checkIncomingMessage(int timeout, int limit) {
-        if(this->_msgSubscriptionId != NULL) {
-            if(_netClientMsg.connected() && !_netClientMsg.available()) {
-                return;
-            }
-            else if (_netClientMsg.available()) {
-                String response = "";
-                // Read the response
-                int statusCode = readResponse(&_netClientMsg, &response);
-                if(statusCode == HTTP_OK) {
-                    StaticJsonBuffer<JSON_PARSER_BUFFER_SIZE> jsonBuffer;
-                    JsonArray& array = jsonBuffer.parseArray(response);
-                    if (array.success()) {
-                        if(_msgCallback || _msgCallbackWithContext || _msgCallbacks.size() > 0) {
-                            for(int i=0; i < array.size(); i++) {
-                                MessageContext ctx;
-                                ctx.messageKey = array[i]["Key"].as<char *>(); 
-                                ctx.sagaId = array[i]["Scope"]["SagaId"].as<char *>();
-                                ctx.scope = (ScopeType)array[i]["Scope"]["Scope"].as<uint8_t>();
-                                ctx.isSaga = ctx.sagaId != NULL;
-                                ctx.sender.type = (SenderType)array[i]["Sender"]["Type"].as<uint8_t>();
-                                ctx.sender.friendlyName = array[i]["Sender"]["FriendlyName"].as<char *>();
-                                ctx.sender.connectionId = array[i]["Sender"]["ConnectionId"].as<char *>();
-                                log_debug("Receiving message %s from %s", ctx.messageKey, ctx.sender.friendlyName);
-                                if(_msgCallback) {
-                                    log_debug("Invoking MessageReceiveCallback registered without context");
-                                    _msgCallback(array[i]);
-                                }
-                                if(_msgCallbackWithContext) {
-                                    log_debug("Invoking MessageReceiveCallback registered with context");
-                                    _msgCallbackWithContext(array[i], ctx);
-                                }
-                                for(int j = 0; j < _msgCallbacks.size(); j++) {
-                                    MessageCallbackSubscription mc = _msgCallbacks.get(j);
-                                    if (mc.id && (mc.msgCallback || mc.msgCallbackWithContext) &&
-                                        (mc.isSagaCallback ? ctx.sagaId != NULL : true) &&
-                                        strcmp (mc.isSagaCallback ? ctx.sagaId : ctx.messageKey, mc.id) == 0) {
-                                        if(mc.msgCallback) {
-                                            log_debug("Invoking MessageCallback '%s' without context", mc.id);
-                                            mc.msgCallback(array[i]);
-                                        }
-                                        if(mc.msgCallbackWithContext) {
-                                            log_debug("Invoking MessageCallback '%s' with context", mc.id);
-                                            mc.msgCallbackWithContext(array[i], ctx);
-                                        }
-                                        if(mc.isSagaCallback) {
-                                            // remove the saga callback
-                                            delete mc.id;
-                                            _msgCallbacks.remove(j);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    else {
-                        log_error("Unable to parse the incoming message");
-                    }
-                }
-                else if(statusCode == HTTP_SERVER_ERROR) {
-                    log_error("Unable to get messages : internal server error");
-                    renewSubscriptions();
-                }
-            }
-            // Do request
-            String strTimeout = String(timeout);
-            String strLimit = String(limit);
-            const char* args[] = { "subscriptionId", this->_msgSubscriptionId,  "timeout", strTimeout.c_str(), "limit", strLimit.c_str() };
-            writeRequest(&_netClientMsg, "GetMessages", args, 3, true);
-        }
-        else {
-            log_trace("checkIncomingMessage : no SubcriptionId");
-        }
+        pollMessages(timeout, limit);
+        dispatchQueuedMessages();
     };
 
     void checkStateObjectUpdate() {
-        checkStateObjectUpdate(DEFAULT_SUBSCRIPTION_TIMEOUT, DEFAULT_SUBSCRIPTION_LIMIT);
+        checkStateObjectUpdate(DEFAULT_SUBSCRIPTION_TIMEOUT, TProfile::DefaultSubscriptionLimit);
     };
     void checkStateObjectUpdate(int timeout) {
-        checkStateObjectUpdate(timeout, DEFAULT_SUBSCRIPTION_LIMIT);
+        checkStateObjectUpdate(timeout, TProfile::DefaultSubscriptionLimit);
     };
     void checkStateObjectUpdate(int timeout, int limit) {
         if(this->_soSubscriptionId != NULL) {
-            if(_netClientSO.connected() && !_netClientSO.available()) {
+            if(renewStateObjectSubscriptions()) {
+                return;
+            }
+            if((_soPollPending && _netClientSO.connected() && !_netClientSO.available()) || _readingItems) {
                 return;
             }
             else if (_netClientSO.available()) {
-                String response = "";
-                // Read the response
-                int statusCode = readResponse(&_netClientSO, &response);
-                if(statusCode == HTTP_OK) {
-                    StaticJsonBuffer<JSON_PARSER_BUFFER_SIZE> jsonBuffer;
-                    JsonArray& array = jsonBuffer.parseArray(response);
-                    if (array.success()) {
-                        if(_soCallback || _soCallbacks.size() > 0) {
-                            for(int i = 0; i < array.size(); i++) {
-                                if(_soCallback) {
-                                    log_debug("Invoking StateObject Callback");
-                                    _soCallback(array[i]["StateObject"]);
-                                }
-                                if(_soCallbacks.size() > 0) {
-                                    const char * sentinel = array[i]["StateObject"]["SentinelName"].as<char *>(); 
-                                    const char * package = array[i]["StateObject"]["PackageName"].as<char *>();
-                                    const char * name = array[i]["StateObject"]["Name"].as<char *>();
-                                    const char * type = array[i]["StateObject"]["Type"].as<char *>();
-                                    for(int j = 0; j < _soCallbacks.size(); j++) {
-                                        StateObjectSubscription subcription = _soCallbacks.get(j);
-                                        if( (strcmp (sentinel, subcription.sentinel) == 0 || strcmp (WILDCARD, subcription.sentinel) == 0) &&
-                                            (strcmp (package, subcription.package) == 0 || strcmp (WILDCARD, subcription.package) == 0) &&
-                                            (strcmp (name, subcription.name) == 0 || strcmp (WILDCARD, subcription.name) == 0) &&
-                                            (strcmp (type, subcription.type) == 0 || strcmp (WILDCARD, subcription.type) == 0)) {
-                                            log_debug("Invoking StateObjectLink registered for %s/%s/%s/%s", subcription.sentinel, subcription.package, subcription.name, subcription.type);
-                                            subcription.soCallback(array[i]["StateObject"]);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    else {
-                        log_error("Unable to parse the StateObjects array");
-                    }
-                }
-                else if(statusCode == HTTP_SERVER_ERROR) {
+                // Read the response (the StateObjects are dispatched as they are read)
+                int statusCode = readItems(&_netClientSO, _soResponse, true);
+                _soPollPending = false;
+                if(statusCode == HTTP_SERVER_ERROR) {
                     log_error("Unable to get StateObjectLinks : internal server error");
-                    renewSubscriptions();
+                    // Renew in the background, the long-poll will be re-armed once the subscriptions are confirmed
+                    beginRenewal(_soRenewal);
+                    _netClientSO.stop();
+                    return;
                 }
             }
             // Do request
-            String strTimeout = String(timeout);
-            String strLimit = String(limit);
-            const char* args[] = { "subscriptionId", this->_soSubscriptionId,  "timeout", strTimeout.c_str(), "limit", strLimit.c_str() };
-            writeRequest(&_netClientSO, "GetStateObjects", args, 3, true);
+            char strTimeout[12], strLimit[12];
+            snprintf(strTimeout, sizeof(strTimeout), "%d", timeout);
+            snprintf(strLimit, sizeof(strLimit), "%d", limit);
+            const char* args[] = { "subscriptionId", this->_soSubscriptionId,  "timeout", strTimeout, "limit", strLimit };
+            _soPollPending = writeRequest(&_netClientSO, "GetStateObjects", args, 3, true);
         }
         else {
             log_trace("checkStateObjectUpdate : no SubcriptionId");
@@ -638,11 +1700,11 @@ class Constellation
 
     bool subscribeToMessage(bool renew = false) {
         if(this->_msgSubscriptionId == NULL) {
-            String response = "";
-            if(sendRequest("SubscribeToMessage", NULL, 0, &response) == HTTP_OK && response.length() == SUBSCRIPTIONID_SIZE + 2) {
-                static char subId[SUBSCRIPTIONID_SIZE + 1];
-                response.substring(1, SUBSCRIPTIONID_SIZE + 2).toCharArray(subId, sizeof(subId));
-                this->_msgSubscriptionId = subId;
+            _response = "";
+            if(sendRequest("SubscribeToMessage", NULL, 0, &_response) == HTTP_OK && _response.length() == SUBSCRIPTIONID_SIZE + 2) {
+                strncpy(_msgSubscriptionIdBuffer, _response.c_str() + 1, SUBSCRIPTIONID_SIZE);
+                _msgSubscriptionIdBuffer[SUBSCRIPTIONID_SIZE] = '\0';
+                this->_msgSubscriptionId = _msgSubscriptionIdBuffer;
                 log_info("SubscribeToMessage:OK - Subscription Id = %s", this->_msgSubscriptionId);
             }
             else {
@@ -657,8 +1719,9 @@ class Constellation
     };
     bool subscribeToGroup(const char* groupName, bool renew = false) {
         if(subscribeToMessage()) {
-            if(!renew) {
-                _msgGroups.add(groupName);
+            if(!renew && !_msgGroups.add(groupName)) {
+                log_error("Unable to subscribe to the group %s : too many groups", groupName);
+                return false;
             }
             const char* args[] = { "subscriptionId", this->_msgSubscriptionId, "group", groupName };
             return sendRequest("SubscribeToMessageGroup", args, 2, NULL) == HTTP_OK;
@@ -680,6 +1743,25 @@ class Constellation
     bool registerMessageCallback(const char* messageKey, MessageCallbackDescriptor descriptor, MESSAGE_CALLBACK_WCONTEXT_SIGNATURE) {
         return registerMessageCallback(messageKey, false, descriptor, NULL, msgCallbackWithContext);
     };
+    // Typed MessageCallback : the Data of the message is bound to the arguments of the callback, ex:
+    //   constellation.registerMessageCallback<int, int>("Add", MessageCallbackDescriptor().addParameter<int>("a").addParameter<int>("b"), [](int a, int b) { ... });
+    // The parameters missing in the descriptor are added from Args (arg0, arg1, ...). A message with invalid Data is not dispatched.
+    template<typename... Args>
+    bool registerMessageCallback(const char* messageKey, MessageCallbackDescriptor descriptor, typename Identity<void (*)(Args...)>::type msgCallback) {
+        return registerTypedMessageCallback<Args...>(messageKey, descriptor, reinterpret_cast<void (*)()>(msgCallback), false);
+    };
+    template<typename... Args>
+    bool registerMessageCallback(const char* messageKey, MessageCallbackDescriptor descriptor, typename Identity<void (*)(Args..., MessageContext)>::type msgCallbackWithContext) {
+        return registerTypedMessageCallback<Args...>(messageKey, descriptor, reinterpret_cast<void (*)()>(msgCallbackWithContext), true);
+    };
+    template<typename... Args>
+    bool registerMessageCallback(const char* messageKey, typename Identity<void (*)(Args...)>::type msgCallback) {
+        return registerTypedMessageCallback<Args...>(messageKey, MessageCallbackDescriptor(), reinterpret_cast<void (*)()>(msgCallback), false);
+    };
+    template<typename... Args>
+    bool registerMessageCallback(const char* messageKey, typename Identity<void (*)(Args..., MessageContext)>::type msgCallbackWithContext) {
+        return registerTypedMessageCallback<Args...>(messageKey, MessageCallbackDescriptor(), reinterpret_cast<void (*)()>(msgCallbackWithContext), true);
+    };
 
     void addMessageCallbackType(const char* typeName, TypeDescriptor typeDescriptor) {
         addTypeDescriptor(typeName, MessageCallbackType, typeDescriptor);
@@ -689,7 +1771,7 @@ class Constellation
     };
     
     bool declarePackageDescriptor() {
-        DynamicJsonBuffer jsonBuffer;
+        JsonWriterBuffer jsonBuffer;
         JsonObject& packageDescriptor = jsonBuffer.createObject();
         packageDescriptor["PackageName"] = this->_packageName;
 
@@ -730,15 +1812,15 @@ class Constellation
     };
     bool subscribeToStateObjects(const char * sentinel, const char * package, const char * name, const char * type) {
         if(this->_soSubscriptionId == NULL) {
-            String response = "";
+            _response = "";
             const char* args[] = { "sentinel", sentinel, "package", package, "name", name, "type", type };    
-            if(sendRequest("SubscribeToStateObjects", args, 4, &response) == HTTP_OK && response.length() == SUBSCRIPTIONID_SIZE + 2) {
-                static char subId[SUBSCRIPTIONID_SIZE + 1];
-                response.substring(1, SUBSCRIPTIONID_SIZE + 2).toCharArray(subId, sizeof(subId));
-                this->_soSubscriptionId = subId;
+            if(sendRequest("SubscribeToStateObjects", args, 4, &_response) == HTTP_OK && _response.length() == SUBSCRIPTIONID_SIZE + 2) {
+                strncpy(_soSubscriptionIdBuffer, _response.c_str() + 1, SUBSCRIPTIONID_SIZE);
+                _soSubscriptionIdBuffer[SUBSCRIPTIONID_SIZE] = '\0';
+                this->_soSubscriptionId = _soSubscriptionIdBuffer;
                 log_info("SubscribeToStateObjects:OK - Subscription Id = %s", this->_soSubscriptionId);
             }
-            else if(response == "null") {
+            else if(strcmp(_response.c_str(), "null") == 0) {
                 log_error("Unable to SubscribeToStateObjects : check your credential !");
             }
             else {
@@ -765,10 +1847,26 @@ class Constellation
         subscription.name = name;
         subscription.type = type;
         subscription.soCallback = soCallback;
-        _soCallbacks.add(subscription);
+        if(!_soCallbacks.add(subscription)) {
+            log_error("Unable to register the StateObjectLink : too many links");
+            return false;
+        }
         return subscribeToStateObjects(sentinel, package, name, type);
     };
 
+    // Last value received for a subscribed StateObject, from the local cache (no network I/O), parsed in the given buffer.
+    // Returns JsonObject::invalid() if it's not cached. 'version' changes each time the StateObject is updated.
+    JsonObject& getCachedStateObject(const char * sentinel, const char * package, const char * name, JsonBuffer& jsonBuffer, uint32_t* version = NULL, unsigned long* lastUpdate = NULL) {
+        const char* json = _soCache.get(sentinel, package, name, version, lastUpdate);
+        if(json == NULL) {
+            return JsonObject::invalid();
+        }
+        return jsonBuffer.parseObject(json);
+    };
+    // Version of the cached StateObject (0 if it's not cached) : to know if it changed without parsing it
+    uint32_t getCachedStateObjectVersion(const char * sentinel, const char * package, const char * name) {
+        return _soCache.version(sentinel, package, name);
+    };
     JsonArray& requestStateObjects(const char * sentinel, const char * package) {
         return requestStateObjects(sentinel, package, WILDCARD, WILDCARD);
     };
@@ -776,11 +1874,11 @@ class Constellation
         return requestStateObjects(sentinel, package, name, WILDCARD);
     };
     JsonArray& requestStateObjects(const char * sentinel, const char * package, const char * name, const char * type) {
-        String response = "";    
+        _response = "";
         const char* args[] = { "sentinel", sentinel, "package", package, "name", name, "type", type };
-        if(sendRequest("RequestStateObjects", args, 4, &response) == HTTP_OK) {
-            StaticJsonBuffer<JSON_PARSER_BUFFER_SIZE> jsonBuffer;
-            JsonArray& obj = jsonBuffer.parseArray(response);
+        if(sendRequest("RequestStateObjects", args, 4, &_response) == HTTP_OK) {
+            StaticJsonBuffer<TProfile::JsonParserBufferSize> jsonBuffer;
+            JsonArray& obj = jsonBuffer.parseArray(parsableJson(_response));
             if (obj.success()) {
                 return obj;
             }
@@ -792,10 +1890,10 @@ class Constellation
     };
 
     JsonObject& getSettings() {
-        String response = "";
-        if(sendRequest("GetSettings", NULL, 0, &response) == HTTP_OK) {
-            StaticJsonBuffer<JSON_PARSER_BUFFER_SIZE> jsonBuffer;
-            JsonObject& obj = jsonBuffer.parseObject(response);
+        _response = "";
+        if(sendRequest("GetSettings", NULL, 0, &_response) == HTTP_OK) {
+            StaticJsonBuffer<TProfile::JsonParserBufferSize> jsonBuffer;
+            JsonObject& obj = jsonBuffer.parseObject(parsableJson(_response));
             if (obj.success()) {
                 return obj;
             }
@@ -807,6 +1905,7 @@ class Constellation
     };
 
     bool sendResponse(MessageContext context, const char* data, ...) {
+        CONSTELLATION_FORMAT_LOCK;
         va_list myargs;
         va_start(myargs, data);
         const char* pData = stringFormat(data, myargs);
@@ -814,7 +1913,7 @@ class Constellation
         return sendResponse(context, pData);
     };
     bool sendResponse(MessageContext context, JsonVariant data) {
-        DynamicJsonBuffer jsonBuffer;
+        JsonWriterBuffer jsonBuffer;
         JsonObject& msg = jsonBuffer.createObject();
         msg["Key"] = "__Response";
         if(data.is<const char*>() || data.is<char*>()) {
@@ -836,6 +1935,7 @@ class Constellation
     };
 
     bool sendMessage(ScopeType scope, const char* scopeArgs, const char* key, const char* data, ...) {
+        CONSTELLATION_FORMAT_LOCK;
         va_list myargs;
         va_start(myargs, data);
         const char* msg = stringFormat(data, myargs);
@@ -849,12 +1949,13 @@ class Constellation
         return sendMessage(scope, scopeArgs, key, strData);
     };
     bool sendMessageWithSaga(MESSAGE_CALLBACK_SIGNATURE, ScopeType scope, const char* scopeArgs, const char* key, const char* data, ...) {
+        CONSTELLATION_FORMAT_LOCK;
         va_list myargs;
         va_start(myargs, data);
         const char* msg = stringFormat(data, myargs);
         va_end(myargs);
-        String *strSagaId = new String(millis());
-        const char* sagaId = strSagaId->c_str();
+        char sagaId[SAGAID_SIZE];
+        snprintf(sagaId, sizeof(sagaId), "%lu", (unsigned long)millis());
         log_debug("SagaId: %s", sagaId);
         const char* args[] = { "scope", getScopeLabel(scope), "args", scopeArgs, "key", key, "data", msg, "sagaId", sagaId };
         if(sendRequest("SendMessage", args, 5, NULL) == HTTP_NO_CONTENT) {
@@ -880,68 +1981,157 @@ class Constellation
         return pushStateObject(name, value, type, NULL, lifetime);
     };
     bool pushStateObject(const char* name, JsonVariant value, const char* type, JsonObject* metadatas, int lifetime = 0){
-        DynamicJsonBuffer jsonBuffer;
-        JsonObject& stateObject = jsonBuffer.createObject();
-        stateObject["Name"] = name;
-        bool isRawJson = false;
-        if(value.is<const char*>() || value.is<char*>()) {
-            const char * strValue = value.as<const char*>();
-             if (strValue[0] == '{' || strValue[0] == '[') {
-                value = RawJson(strValue);
-                isRawJson = true;
-             }
+        return sendStateObject(name, value, type, metadatas, lifetime, _deltaPublishing);
+    };
+    // Push the data accumulated by 'publisher' (ex: a TimeSeries) as one StateObject of its type. The JSON value is printed
+    // into the request (in the outbound queue in network task mode : it must fit in TProfile::OutboundSlotSize).
+    bool pushStateObject(const char* name, StateObjectPublisher& publisher, int lifetime = 0) {
+        if(!publisher.hasValue()) {
+            return true;
         }
-        stateObject["Value"] = value;
-        if(type == NULL) {
-            if(value.is<bool>()) {
-                stateObject["Type"] = "System.Boolean";
-            }
-            else if(value.is<float>()) {
-                stateObject["Type"] = "System.Float";
-            }
-            else if(value.is<double>()) {
-                stateObject["Type"] = "System.Double";
-            }
-            else if(value.is<signed int>() || value.is<unsigned int>()) {
-                stateObject["Type"] = "System.Int32";
-            }
-            else if(value.is<signed short>() || value.is<unsigned short>()) {
-                stateObject["Type"] = "System.Int16";
-            }
-            else if(value.is<signed long>() || value.is<unsigned long>()) {
-                stateObject["Type"] = "System.Int64";
-            }
-            else if(!isRawJson && (value.is<const char*>() || value.is<char*>())) {
-                stateObject["Type"] = "System.String";
-            }
-            else if(value.is<signed char>() || value.is<unsigned char>()) {
-                stateObject["Type"] = "System.Char";
+        PublisherStateObject stateObject = { name, &publisher, lifetime, millis() };
+        uint32_t hash = 0;
+#ifdef CONSTELLATION_NETWORK_TASK
+        std::unique_lock<std::mutex> deltaLock(_deltaMutex, std::defer_lock);
+        if(_deltaPublishing) {
+            deltaLock.lock();
+        }
+#endif
+        if(_deltaPublishing) {
+            HashPrint hashPrint;
+            stateObject.printTo(hashPrint);
+            hash = hashPrint.hash();
+            if(!_deltaPublisher.mustPush(name, hash, false, 0, lifetime)) {
+                log_debug("StateObject '%s' unchanged : push skipped", name);
+                publisher.pushed();
+                return true;
             }
         }
-        else {
-            stateObject["Type"] = type;	
+        if(sendPostRequest("PushStateObject", stateObject, NULL) != HTTP_NO_CONTENT) {
+            return false;
         }
-        if(lifetime > 0) {
-            stateObject["Lifetime"] = lifetime;
+        if(_deltaPublishing) {
+            _deltaPublisher.pushed(name, hash, 0);
         }
-        if(metadatas != NULL) {
-            stateObject["Metadatas"] = *metadatas;
+        publisher.pushed();
+        return true;
+    };
+    // Push 'publisher' as the StateObject 'name' every 'interval' ms from loop() (nothing is sent while it's empty) and declare
+    // its type in the package descriptor (call it before declarePackageDescriptor). Returns the task id, or -1.
+    int publishStateObject(const char* name, StateObjectPublisher& publisher, unsigned long interval, int lifetime = 0) {
+        if(_publisherCount >= TProfile::MaxPublishers) {
+            log_error("Unable to publish %s : too many publishers", name);
+            return -1;
         }
-        return sendPostRequest("PushStateObject", stateObject, NULL) == HTTP_NO_CONTENT;
+        ScheduledPublisher& scheduled = _publishers[_publisherCount];
+        scheduled.owner = this;
+        scheduled.name = name;
+        scheduled.publisher = &publisher;
+        scheduled.lifetime = lifetime;
+        int id = addTask(publishTask, &scheduled, interval);
+        if(id < 0) {
+            return -1;
+        }
+        _publisherCount++;
+        addPublisherType(publisher);
+        return id;
     };
 
     bool purgeStateObjects() {
-        return pushStateObject(WILDCARD, WILDCARD);
+        resetDeltaPublisher(NULL);
+        return sendStateObject(WILDCARD, WILDCARD, NULL, NULL, 0, false);
     };
     bool purgeStateObjects(const char* name) {
-        return pushStateObject(name, WILDCARD);
+        resetDeltaPublisher(name);
+        return sendStateObject(name, WILDCARD, NULL, NULL, 0, false);
     };
     bool purgeStateObjects(const char* name, const char* type) {
+        resetDeltaPublisher(name);
         const char* args[] = { "name", name, "type", type };
         return sendRequest("PurgeStateObjects", args, 2, NULL) == HTTP_NO_CONTENT;
     };
 
+    // Ask for compressed responses (gzip or deflate), inflated on the fly with a window of TProfile::InflateWindowSize bytes
+    // taken on the heap : the server must compress with a window not larger than that (ex: "gzip_window 4k" for nginx).
+    // A response that can't be decoded disables the compression : the request is sent again uncompressed if it's idempotent
+    // (the messages or StateObjects of a long-poll are lost). Not available in heap-free mode.
+    bool setCompression(bool enable) {
+        static_assert(!TProfile::HeapFree, "The compressed responses need the heap : not available with a heap-free profile");
+        if(this->_inflating) {
+            log_error("Unable to change the compression while a response is inflated");
+            return false;
+        }
+        if(!enable) {
+            delete this->_inflater;
+            this->_inflater = NULL;
+        }
+        else if(this->_inflater == NULL) {
+            this->_inflater = new Inflater<TProfile::InflateWindowSize>();
+            if(this->_inflater == NULL) {
+                log_error("Unable to allocate the inflater");
+                return false;
+            }
+        }
+        return true;
+    };
+    // Ask for MessagePack (compact binary) messages & StateObjects, and push the StateObjects in MessagePack
+    // once the server has answered in MessagePack. JSON is still used with a server without MessagePack support.
+    Constellation& setMessagePack(bool enable) {
+        this->_messagePack = enable;
+        return *this;
+    };
+    // Skip the pushes of unchanged StateObjects (opt-in)
+    Constellation& setDeltaPublishing(bool enable) {
+        this->_deltaPublishing = enable;
+        return *this;
+    };
+    // Push a numeric StateObject only if it changed by at least 'deadband' and not more often than 'minInterval' (ms). Enables the delta publishing.
+    bool setPublishRule(const char* name, float deadband, unsigned long minInterval = 0) {
+        this->_deltaPublishing = true;
+        if(!_deltaPublisher.setRule(name, deadband, minInterval)) {
+            log_error("Unable to add the publish rule for %s : too many StateObjects", name);
+            return false;
+        }
+        return true;
+    };
+
+    // Run 'callback' every 'interval' ms from loop(). Set 'duringIO' if the task doesn't use Constellation :
+    // it will also run while the library waits for a response. Returns the task id, or -1 if there are too many tasks.
+    int addTask(void (*callback)(), unsigned long interval, bool duringIO = false) {
+        int id = _scheduler.add(callback, interval, duringIO);
+        if(id < 0) {
+            log_error("Unable to add the task : too many tasks");
+        }
+        return id;
+    };
+    int addTask(void (*callback)(void*), void* arg, unsigned long interval, bool duringIO = false) {
+        int id = _scheduler.add(callback, arg, interval, duringIO);
+        if(id < 0) {
+            log_error("Unable to add the task : too many tasks");
+        }
+        return id;
+    };
+    bool setTaskInterval(int id, unsigned long interval) {
+        return _scheduler.setInterval(id, interval);
+    };
+    bool enableTask(int id, bool enabled = true) {
+        return _scheduler.enable(id, enabled);
+    };
+    // Run the due tasks (called by loop())
+    int runTasks() {
+        return _scheduler.run(TProfile::MaxTasksPerTick);
+    };
+    // Largest delay (ms) between the planned and the actual run of a task
+    unsigned long getTaskMaxLateness(int id) {
+        return _scheduler.getMaxLateness(id);
+    };
+    // Lateness (ms) of the tasks for the given percentile (ex: 99), rounded up to a power of 2
+    unsigned long getTaskLatenessPercentile(uint8_t percentile) {
+        return _scheduler.getLatenessPercentile(percentile);
+    };
+
     bool writeInfo(const char* text, ...) {
+        CONSTELLATION_FORMAT_LOCK;
         va_list myargs;
         va_start(myargs, text);
         const char* msg = stringFormat(text, myargs);
@@ -949,6 +2139,7 @@ class Constellation
         return writeLog(msg, LevelInfo);
     };
     bool writeWarn(const char* text, ...) {
+        CONSTELLATION_FORMAT_LOCK;
         va_list myargs;
         va_start(myargs, text);
         const char* msg = stringFormat(text, myargs);
@@ -956,6 +2147,7 @@ class Constellation
         return writeLog(msg, LevelWarn);
     };
     bool writeError(const char* text, ...) {
+        CONSTELLATION_FORMAT_LOCK;
         va_list myargs;
         va_start(myargs, text);
         const char* msg = stringFormat(text, myargs);
@@ -974,17 +2166,8 @@ class Constellation
     Constellation& setServer(const char * constellationHost, uint16_t constellationPort, const char * path){
         this->_constellationHost = constellationHost;
         this->_constellationPort = constellationPort;
-        // Generate the base URI path
-        static String strPath;
-        strPath = String(path);
-        if(!strPath.startsWith("/")) {
-            strPath = "/" + strPath;
-        }
-        if(!strPath.endsWith("/")) {
-            strPath += "/";
-        }
-        strPath += "rest/constellation/";
-        this->_constellationPath = strPath.c_str();
+        // The base URI path is generated for each request (see printUri)
+        this->_constellationPath = path;
         return *this;
     };
     Constellation& setIdentity(const char * sentinel, const char * package, const char * accessKey){
@@ -1037,14 +2220,63 @@ class Constellation
         this->_httpTimeout = timeout;
         return *this;
     };
+    // Open the three connections in advance (TLS handshakes included), ex: in setup() or after a WiFi reconnection
+    bool warmUp() {
+        unsigned long start = millis();
+        bool success = openClient(&_netClient, "GET", "WarmUp", NULL);
+        success &= openClient(&_netClientMsg, "GET", "WarmUp", NULL);
+        success &= openClient(&_netClientSO, "GET", "WarmUp", NULL);
+        log_debug("Connections warmed up in %lu ms", millis() - start);
+        return success;
+    };
+    // Binary trace of the network & dispatch events (TProfile::TraceSize events), recorded without formatting.
+    // dumpTrace() prints it in hexadecimal, to decode off-line with extras/trace_decode.py.
+    void dumpTrace(Print& out = Serial) {
+        _trace.dump(out);
+    };
+    void clearTrace() {
+        _trace.clear();
+    };
+    // Records an application event in the trace (ids from TraceUser)
+    void recordTrace(uint16_t event, uint16_t arg = 0, uint32_t value = 0) {
+        _trace.record(event, arg, value);
+    };
+    // Connections established by the library (with their connect time) & requests retried on a new connection
+    const ConnectionStats& getConnectionStats() {
+        return _connectionStats;
+    };
+    // Max. messages (0 = all) & time (ms, 0 = no limit) spent in the MessageCallbacks per loop(), at least one message is dispatched.
+    // The messages left wait in the inbound ring (TProfile::InboundRingSize) or the queue of the network task,
+    // and the long-poll asks for fewer messages while it's filling up.
+    void setDispatchBudget(int maxMessages, unsigned long maxTime = 0) {
+        _dispatchMaxCount = maxMessages;
+        _dispatchMaxTime = maxTime;
+    };
+    // Messages & StateObject updates received twice and not dispatched (see TProfile::DedupMessages & DedupStateObjects)
+    uint32_t getDuplicateCount() {
+        return _dedup.duplicates();
+    };
+    // Requests queued for the network task, per lane : latency from the queuing to the response, drops & aged bulk requests
+    OutboundLaneStats getOutboundStats(OutboundLane lane) {
+        OutboundLaneStats stats = { 0, 0, 0, 0, 0, 0 };
+#ifdef CONSTELLATION_NETWORK_TASK
+        if(_networkTask != NULL) {
+            stats = _networkTask->laneStats[lane];
+            stats.dropped = _networkTask->laneDropped[lane];
+        }
+#endif
+        return stats;
+    };
+    // 'onClientConnected' is invoked for each new connection, to verify it
     Constellation& onClientConnected(bool (*onClientConnected)(TNetworkClass&)) {
         this->_onClientConnected = onClientConnected;
         return *this;
     };   
 };
 
+// One buffer per thread on Linux, a single one elsewhere (ESP32 : call it from one task, or use the methods of the instance)
 const char* stringFormat(const char* format, ...) {
-    static char result[STRING_FORMAT_BUFFER];
+    static CONSTELLATION_THREAD_LOCAL char result[STRING_FORMAT_BUFFER];
     va_list myargs;
     va_start(myargs, format);
     vsnprintf(result, STRING_FORMAT_BUFFER, format, myargs);
@@ -1052,4 +2284,9 @@ const char* stringFormat(const char* format, ...) {
     return result;
 };
 
+#undef log_error
+#undef log_info
+#undef log_debug
+#undef log_trace
+
 #endif
@@ -0,0 +1,121 @@
+/**************************************************************************/
+/*!
+    @file     DedupFilter.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_DEDUP_FILTER_
+#define _CONSTELLATION_DEDUP_FILTER_
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+    Detects the items delivered twice by the server (ex: after a subscription renewal or a lost response), in fixed memory :
+    - the fingerprints (hash of the JSON text) of the last MESSAGES messages, a message being a duplicate if the same text
+      was received during the last window ms. The messages have no id : the same message really sent twice within the
+      window (ex: a "Toggle" command) is dropped too, so it's only for the nodes whose messages are idempotent,
+    - the version (hash of the LastUpdate) of STATEOBJECTS StateObjects, an update being a duplicate if its version is the
+      one already dispatched (the oldest StateObject is forgotten first).
+*/
+template<int MESSAGES, int STATEOBJECTS>
+class DedupFilter
+{
+  private:
+    typedef struct {
+        uint32_t hash;              // 0 = free
+        unsigned long receivedAt;
+    } Fingerprint;
+    typedef struct {
+        uint32_t keyHash;           // 0 = free
+        uint32_t versionHash;
+    } Version;
+    Fingerprint _messages[MESSAGES > 0 ? MESSAGES : 1];
+    Version _stateObjects[STATEOBJECTS > 0 ? STATEOBJECTS : 1];
+    int _nextMessage;
+    int _nextStateObject;
+    uint32_t _duplicates;
+
+  public:
+    DedupFilter() : _duplicates(0) {
+        clear();
+    }
+
+    static bool messagesEnabled() {
+        return MESSAGES > 0;
+    };
+    static bool stateObjectsEnabled() {
+        return STATEOBJECTS > 0;
+    };
+
+    // True if a message with the same hash was received during the last 'window' ms, otherwise it's remembered.
+    // The window isn't extended by the duplicates : a message sent again on purpose passes once it's over.
+    bool isDuplicateMessage(uint32_t hash, unsigned long window) {
+        if(MESSAGES == 0) {
+            return false;
+        }
+        hash |= 1;
+        unsigned long now = millis();
+        for(int i = 0; i < MESSAGES; i++) {
+            if(_messages[i].hash == hash && now - _messages[i].receivedAt < window) {
+                _duplicates++;
+                return true;
+            }
+        }
+        _messages[_nextMessage].hash = hash;
+        _messages[_nextMessage].receivedAt = now;
+        _nextMessage = (_nextMessage + 1) % MESSAGES;
+        return false;
+    };
+
+    // True if this version of the StateObject was the last one dispatched, otherwise it's remembered
+    bool isDuplicateStateObject(uint32_t keyHash, uint32_t versionHash) {
+        if(STATEOBJECTS == 0) {
+            return false;
+        }
+        keyHash |= 1;
+        for(int i = 0; i < STATEOBJECTS; i++) {
+            if(_stateObjects[i].keyHash == keyHash) {
+                if(_stateObjects[i].versionHash == versionHash) {
+                    _duplicates++;
+                    return true;
+                }
+                _stateObjects[i].versionHash = versionHash;
+                return false;
+            }
+        }
+        _stateObjects[_nextStateObject].keyHash = keyHash;
+        _stateObjects[_nextStateObject].versionHash = versionHash;
+        _nextStateObject = (_nextStateObject + 1) % STATEOBJECTS;
+        return false;
+    };
+
+    uint32_t duplicates() {
+        return _duplicates;
+    };
+    void clear() {
+        memset(_messages, 0, sizeof(_messages));
+        memset(_stateObjects, 0, sizeof(_stateObjects));
+        _nextMessage = 0;
+        _nextStateObject = 0;
+    };
+};
+
+#endif
@@ -0,0 +1,135 @@
+/**************************************************************************/
+/*!
+    @file     DeltaPublisher.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_DELTA_PUBLISHER_
+#define _CONSTELLATION_DELTA_PUBLISHER_
+
+#include <math.h>
+#include "Hashing.h"
+
+/*
+    Remembers, for each StateObject name, a hash of the last pushed StateObject to skip the identical pushes.
+    Numeric StateObjects can also have a deadband (minimal change to push) and a minimum interval between pushes.
+    A StateObject with a lifetime is always pushed again before it expires (keep-alive).
+*/
+template<int CAPACITY>
+class DeltaPublisher
+{
+  private:
+    typedef struct {
+        uint32_t nameHash;
+        uint32_t valueHash;         // 0 when nothing has been pushed yet
+        float lastValue;
+        unsigned long lastPush;
+        float deadband;
+        unsigned long minInterval;
+        bool hasRule;
+    } Entry;
+    Entry _entries[CAPACITY];
+    int _size;
+
+    Entry* find(uint32_t nameHash) {
+        for(int i = 0; i < _size; i++) {
+            if(_entries[i].nameHash == nameHash) {
+                return &_entries[i];
+            }
+        }
+        return NULL;
+    };
+    Entry* findOrAdd(uint32_t nameHash) {
+        Entry* entry = find(nameHash);
+        if(entry == NULL) {
+            if(_size < CAPACITY) {
+                entry = &_entries[_size++];
+            }
+            else {
+                // Full : recycle the least recently pushed entry without rule
+                for(int i = 0; i < _size; i++) {
+                    if(!_entries[i].hasRule && (entry == NULL || (long)(_entries[i].lastPush - entry->lastPush) < 0)) {
+                        entry = &_entries[i];
+                    }
+                }
+                if(entry == NULL) {
+                    return NULL;
+                }
+            }
+            memset(entry, 0, sizeof(Entry));
+            entry->nameHash = nameHash;
+        }
+        return entry;
+    };
+
+  public:
+    DeltaPublisher() : _size(0) {}
+
+    bool setRule(const char* name, float deadband, unsigned long minInterval) {
+        Entry* entry = findOrAdd(fnv1a(name));
+        if(entry == NULL) {
+            return false;
+        }
+        entry->deadband = deadband;
+        entry->minInterval = minInterval;
+        entry->hasRule = true;
+        return true;
+    };
+
+    // Returns true if the StateObject has to be pushed. The lifetime is in seconds (0 = no lifetime)
+    bool mustPush(const char* name, uint32_t valueHash, bool isNumeric, float value, int lifetime) {
+        Entry* entry = find(fnv1a(name));
+        if(entry == NULL || entry->valueHash == 0) {
+            return true;
+        }
+        unsigned long elapsed = millis() - entry->lastPush;
+        if(lifetime > 0 && elapsed >= (unsigned long)lifetime * 750UL) {
+            return true; // keep-alive, before 3/4 of the lifetime
+        }
+        if(elapsed < entry->minInterval || valueHash == entry->valueHash) {
+            return false;
+        }
+        if(isNumeric && entry->deadband > 0 && fabs(value - entry->lastValue) < entry->deadband) {
+            return false;
+        }
+        return true;
+    };
+
+    void pushed(const char* name, uint32_t valueHash, float value) {
+        Entry* entry = findOrAdd(fnv1a(name));
+        if(entry != NULL) {
+            entry->valueHash = valueHash != 0 ? valueHash : 1;
+            entry->lastValue = value;
+            entry->lastPush = millis();
+        }
+    };
+
+    // Forget the last pushed values (after a purge), the rules are kept
+    void reset(const char* name = NULL) {
+        uint32_t nameHash = name != NULL ? fnv1a(name) : 0;
+        for(int i = 0; i < _size; i++) {
+            if(name == NULL || _entries[i].nameHash == nameHash) {
+                _entries[i].valueHash = 0;
+            }
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,73 @@
+/**************************************************************************/
+/*!
+    @file     Hashing.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_HASHING_
+#define _CONSTELLATION_HASHING_
+
+#include <stdint.h>
+#include <Print.h>
+
+// 32-bit FNV-1a : small, fast and good enough to detect changes
+#define FNV_OFFSET_BASIS 2166136261UL
+#define FNV_PRIME 16777619UL
+
+inline uint32_t fnv1a(const uint8_t* data, size_t size, uint32_t hash = FNV_OFFSET_BASIS) {
+    while (size--) {
+        hash = (hash ^ *data++) * FNV_PRIME;
+    }
+    return hash;
+}
+
+inline uint32_t fnv1a(const char* str, uint32_t hash = FNV_OFFSET_BASIS) {
+    while (*str) {
+        hash = (hash ^ (uint8_t)*str++) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Print that hashes what is printed to it (ex: a JsonObject serialized with printTo) without storing it
+class HashPrint : public Print {
+  public:
+    HashPrint() : _hash(FNV_OFFSET_BASIS) {}
+
+    using Print::write;
+
+    virtual size_t write(uint8_t c) {
+        _hash = (_hash ^ c) * FNV_PRIME;
+        return 1;
+    }
+
+    virtual size_t write(const uint8_t* data, size_t size) {
+        _hash = fnv1a(data, size, _hash);
+        return size;
+    }
+
+    uint32_t hash() const {
+        return _hash;
+    }
+
+  private:
+    uint32_t _hash;
+};
+
+#endif
@@ -0,0 +1,131 @@
+/**************************************************************************/
+/*!
+    @file     InboundRing.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_INBOUND_RING_
+#define _CONSTELLATION_INBOUND_RING_
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+    FIFO of variable-length JSON items in a fixed buffer of SIZE bytes, to dispatch them after the long-poll is re-armed.
+    Each record is a 2-byte length then the text (null-terminated), always contiguous : when a record doesn't fit at the end
+    of the buffer, it's written at the start and the reader skips the end (the free space is then between the two).
+*/
+template<size_t SIZE>
+class InboundRing
+{
+  private:
+    typedef uint16_t Header;
+    alignas(Header) uint8_t _buffer[SIZE > 0 ? SIZE : 1];
+    size_t _head;                   // first record to read
+    size_t _tail;                   // next record to write
+    size_t _end;                    // end of the records before the wrap (when wrapped)
+    bool _wrapped;                  // the tail is behind the head
+    size_t _count;
+    size_t _pending;                // size of the reserved record (0 if none)
+    uint16_t _averageSize;          // moving average of the record sizes
+
+    static size_t recordSize(size_t length) {
+        return (sizeof(Header) + length + 1 + sizeof(Header) - 1) & ~(sizeof(Header) - 1);
+    };
+
+  public:
+    InboundRing() : _head(0), _tail(0), _end(0), _wrapped(false), _count(0), _pending(0), _averageSize(0) {}
+
+    static bool enabled() {
+        return SIZE > 0;
+    };
+
+    // Returns room for a text of 'length' characters (+ the terminator) to fill before commit(), or NULL if the ring is full
+    char* reserve(size_t length) {
+        size_t size = recordSize(length);
+        if(SIZE == 0 || length > 0xFFFE) {
+            return NULL;
+        }
+        if(_count == 0) {
+            _head = _tail = 0;
+            _wrapped = false;
+        }
+        if(_wrapped ? size > _head - _tail : (size > SIZE - _tail && size > _head)) {
+            return NULL;
+        }
+        if(!_wrapped && size > SIZE - _tail) {
+            _end = _tail;
+            _tail = 0;
+            _wrapped = true;
+        }
+        *(Header*)(_buffer + _tail) = length;
+        _pending = size;
+        _averageSize = _averageSize == 0 ? size : _averageSize + ((int)size - (int)_averageSize) / 8;
+        return (char*)(_buffer + _tail + sizeof(Header));
+    };
+    void commit() {
+        _tail += _pending;
+        _pending = 0;
+        _count++;
+    };
+    bool push(const char* json, size_t length) {
+        char* record = reserve(length);
+        if(record == NULL) {
+            return false;
+        }
+        memcpy(record, json, length);
+        record[length] = '\0';
+        commit();
+        return true;
+    };
+
+    // Oldest text (writable, to be parsed in place) or NULL if the ring is empty
+    char* front(size_t* length = NULL) {
+        if(_count == 0) {
+            return NULL;
+        }
+        if(length != NULL) {
+            *length = *(Header*)(_buffer + _head);
+        }
+        return (char*)(_buffer + _head + sizeof(Header));
+    };
+    void release() {
+        if(_count == 0) {
+            return;
+        }
+        _head += recordSize(*(Header*)(_buffer + _head));
+        if(_wrapped && _head >= _end) {
+            _head = 0;
+            _wrapped = false;
+        }
+        _count--;
+    };
+
+    size_t count() {
+        return _count;
+    };
+    // Records of the average size that still fit
+    size_t room() {
+        size_t free = _count == 0 ? SIZE : (_wrapped ? _head - _tail : SIZE - _tail + _head);
+        return _averageSize == 0 ? free : free / _averageSize;
+    };
+};
+
+#endif
@@ -0,0 +1,536 @@
+/**************************************************************************/
+/*!
+    @file     Inflater.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_INFLATER_
+#define _CONSTELLATION_INFLATER_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <Print.h>
+
+typedef enum {
+    InflateRaw,     // raw deflate stream
+    InflateZlib,    // "Content-Encoding: deflate" (RFC 1950)
+    InflateGzip     // "Content-Encoding: gzip" (RFC 1952)
+} InflateFormat;
+
+/*
+    Streaming DEFLATE decoder (RFC 1951) : the compressed bytes are written as they are read (ex: from the socket)
+    and the inflated bytes are written to the output as soon as they're decoded, so nothing but the window is buffered.
+    WINDOW (power of 2) is the largest back-reference distance supported : the server must compress with a window
+    not larger than that (ex: "gzip_window 4k" with nginx, windowBits 12 with zlib), otherwise the decoding fails.
+*/
+template<size_t WINDOW>
+class Inflater : public Print
+{
+    static_assert(WINDOW >= 256 && (WINDOW & (WINDOW - 1)) == 0, "The window of the inflater must be a power of 2");
+
+  private:
+    typedef enum {
+        Header, BlockHeader, StoredLength, StoredComplement, Stored, DynamicHeader, CodeLengthCodes, CodeLengths, CodeLengthRepeat,
+        Symbol, LengthExtra, Distance, DistanceExtra, Trailer, Done, Failed
+    } State;
+    // Canonical Huffman code : number of codes of each length & symbols ordered by code
+    typedef struct {
+        uint16_t count[16];
+        uint16_t symbol[288];
+    } Huffman;
+    typedef struct {
+        uint16_t count[16];
+        uint16_t symbol[30];
+    } DistanceHuffman;
+
+    Print* _output;
+    InflateFormat _format;
+    State _state;
+    const char* _error;
+    uint32_t _bits;             // bit accumulator, the next bit first
+    uint8_t _bitCount;
+    bool _final;
+    uint16_t _headerPos;
+    uint16_t _skip;
+    uint8_t _flags;
+    uint32_t _check;            // CRC-32 (gzip) or Adler-32 (zlib) of the output
+    uint8_t _trailer[8];
+    // Current block
+    uint16_t _length;
+    uint16_t _distance;
+    uint8_t _extra;
+    uint16_t _symbol;
+    uint16_t _literals;
+    uint8_t _distances;
+    uint8_t _codeLengthCount;
+    uint16_t _index;
+    uint8_t _lengths[320];
+    Huffman _literalCode;
+    DistanceHuffman _distanceCode;  // also the code of the code lengths while reading a dynamic block header
+    // Output
+    uint8_t _window[WINDOW];
+    uint32_t _total;
+
+    uint32_t take(uint8_t count) {
+        uint32_t value = _bits & ((1UL << count) - 1);
+        _bits >>= count;
+        _bitCount -= count;
+        return value;
+    };
+    // Decodes the next symbol : -1 if more bits are needed, -2 if the code is invalid
+    template<typename THuffman>
+    int decode(const THuffman& huffman) {
+        int code = 0, first = 0, index = 0;
+        for(uint8_t length = 1; length < 16; length++) {
+            if(length > _bitCount) {
+                return -1;
+            }
+            code |= (_bits >> (length - 1)) & 1;
+            int count = huffman.count[length];
+            if(code - count < first) {
+                take(length);
+                return huffman.symbol[index + (code - first)];
+            }
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -2;
+    };
+    template<typename THuffman>
+    bool build(THuffman& huffman, const uint8_t* lengths, int count) {
+        uint16_t offsets[16];
+        memset(huffman.count, 0, sizeof(huffman.count));
+        for(int symbol = 0; symbol < count; symbol++) {
+            huffman.count[lengths[symbol]]++;
+        }
+        int left = 1;
+        for(int length = 1; length < 16; length++) {
+            left = (left << 1) - huffman.count[length];
+            if(left < 0) {
+                return false; // over-subscribed
+            }
+        }
+        offsets[1] = 0;
+        for(int length = 1; length < 15; length++) {
+            offsets[length + 1] = offsets[length] + huffman.count[length];
+        }
+        for(int symbol = 0; symbol < count; symbol++) {
+            if(lengths[symbol] != 0) {
+                huffman.symbol[offsets[lengths[symbol]]++] = symbol;
+            }
+        }
+        return true;
+    };
+    void output(uint8_t c) {
+        _window[_total++ & (WINDOW - 1)] = c;
+        if(_format == InflateGzip) {
+            static const uint32_t crc[16] = {
+                0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+                0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+            _check ^= c;
+            _check = (_check >> 4) ^ crc[_check & 15];
+            _check = (_check >> 4) ^ crc[_check & 15];
+        }
+        else if(_format == InflateZlib) {
+            uint32_t a = ((_check & 0xFFFF) + c) % 65521;
+            uint32_t b = ((_check >> 16) + a) % 65521;
+            _check = (b << 16) | a;
+        }
+        _output->write(c);
+    };
+    void fail(const char* reason) {
+        _state = Failed;
+        _error = reason;
+    };
+    void endOfStream() {
+        // The trailer starts on the next byte
+        take(_bitCount & 7);
+        _headerPos = 0;
+        _state = _format == InflateRaw ? Done : Trailer;
+    };
+    // Wrapper header, byte by byte
+    void header(uint8_t c) {
+        if(_format == InflateZlib) {
+            if(_headerPos++ == 0) {
+                _flags = c;
+                return;
+            }
+            if((_flags & 0x0F) != 8 || ((_flags << 8) | c) % 31 != 0 || (c & 0x20)) {
+                fail("invalid zlib header");
+            }
+            else if((1UL << ((_flags >> 4) + 8)) > WINDOW) {
+                fail("window larger than the inflater window");
+            }
+            else {
+                _state = BlockHeader;
+            }
+            return;
+        }
+        // gzip : fixed header then the optional fields given by the flags
+        if(_headerPos < 10) {
+            if((_headerPos == 0 && c != 0x1F) || (_headerPos == 1 && c != 0x8B) || (_headerPos == 2 && c != 8) || (_headerPos == 3 && (c & 0xE0))) {
+                fail("invalid gzip header");
+                return;
+            }
+            if(_headerPos == 3) {
+                _flags = c;
+            }
+            _headerPos++;
+        }
+        else if(_flags & 0x04) { // FEXTRA : length & data
+            if(_headerPos == 10) {
+                _skip = c;
+                _headerPos++;
+            }
+            else if(_headerPos == 11) {
+                _skip |= c << 8;
+                _headerPos++;
+            }
+            else {
+                _skip--;
+            }
+            if(_headerPos == 12 && _skip == 0) {
+                _flags &= ~0x04;
+            }
+        }
+        else if(_flags & 0x08) { // FNAME
+            if(c == 0) {
+                _flags &= ~0x08;
+            }
+        }
+        else if(_flags & 0x10) { // FCOMMENT
+            if(c == 0) {
+                _flags &= ~0x10;
+            }
+        }
+        else if(_flags & 0x02) { // FHCRC
+            if(++_skip == 2) {
+                _flags &= ~0x02;
+            }
+        }
+        if(_headerPos >= 10 && (_flags & 0x1E) == 0) {
+            _state = BlockHeader;
+        }
+    };
+    void trailer(uint8_t c) {
+        _trailer[_headerPos++] = c;
+        if(_format == InflateZlib && _headerPos == 4) {
+            uint32_t adler = ((uint32_t)_trailer[0] << 24) | ((uint32_t)_trailer[1] << 16) | ((uint32_t)_trailer[2] << 8) | _trailer[3];
+            if(adler != _check) {
+                fail("Adler-32 mismatch");
+                return;
+            }
+            _state = Done;
+        }
+        else if(_format == InflateGzip && _headerPos == 8) {
+            uint32_t crc = _trailer[0] | ((uint32_t)_trailer[1] << 8) | ((uint32_t)_trailer[2] << 16) | ((uint32_t)_trailer[3] << 24);
+            uint32_t size = _trailer[4] | ((uint32_t)_trailer[5] << 8) | ((uint32_t)_trailer[6] << 16) | ((uint32_t)_trailer[7] << 24);
+            if(crc != ~_check || size != _total) {
+                fail("CRC-32 mismatch");
+                return;
+            }
+            _state = Done;
+        }
+    };
+    // Runs one step of the decoder : false if more bits are needed (or at the end)
+    bool step() {
+        static const uint16_t lengthBase[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t lengthExtra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t distanceBase[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t distanceExtra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        static const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+        int symbol;
+        switch(_state) {
+            case BlockHeader:
+                if(_bitCount < 3) {
+                    return false;
+                }
+                _final = take(1);
+                switch(take(2)) {
+                    case 0:
+                        take(_bitCount & 7);
+                        _state = StoredLength;
+                        break;
+                    case 1: // fixed codes
+                        memset(_lengths, 8, 144);
+                        memset(_lengths + 144, 9, 112);
+                        memset(_lengths + 256, 7, 24);
+                        memset(_lengths + 280, 8, 8);
+                        build(_literalCode, _lengths, 288);
+                        memset(_lengths, 5, 30);
+                        build(_distanceCode, _lengths, 30);
+                        _state = Symbol;
+                        break;
+                    case 2:
+                        _state = DynamicHeader;
+                        break;
+                    default:
+                        fail("invalid block type");
+                        return false;
+                }
+                return true;
+            case StoredLength:
+                if(_bitCount < 16) {
+                    return false;
+                }
+                _length = take(16);
+                _state = StoredComplement;
+                return true;
+            case StoredComplement:
+                if(_bitCount < 16) {
+                    return false;
+                }
+                if((uint16_t)~take(16) != _length) {
+                    fail("invalid stored block length");
+                    return false;
+                }
+                _state = Stored;
+                return true;
+            case Stored:
+                if(_length == 0) {
+                    if(_final) {
+                        endOfStream();
+                    }
+                    else {
+                        _state = BlockHeader;
+                    }
+                    return true;
+                }
+                if(_bitCount < 8) {
+                    return false;
+                }
+                output(take(8));
+                _length--;
+                return true;
+            case DynamicHeader:
+                if(_bitCount < 14) {
+                    return false;
+                }
+                _literals = take(5) + 257;
+                _distances = take(5) + 1;
+                _codeLengthCount = take(4) + 4;
+                if(_literals > 286 || _distances > 30) {
+                    fail("invalid dynamic block header");
+                    return false;
+                }
+                memset(_lengths, 0, 19);
+                _index = 0;
+                _state = CodeLengthCodes;
+                return true;
+            case CodeLengthCodes:
+                if(_bitCount < 3) {
+                    return false;
+                }
+                _lengths[codeLengthOrder[_index++]] = take(3);
+                if(_index == _codeLengthCount) {
+                    if(!build(_distanceCode, _lengths, 19)) {
+                        fail("invalid code lengths code");
+                        return false;
+                    }
+                    _index = 0;
+                    _state = CodeLengths;
+                }
+                return true;
+            case CodeLengths:
+                if(_index == _literals + _distances) {
+                    if(_lengths[256] == 0) {
+                        fail("missing end-of-block code");
+                        return false;
+                    }
+                    if(!build(_literalCode, _lengths, _literals) || !build(_distanceCode, _lengths + _literals, _distances)) {
+                        fail("invalid literal/length or distance code");
+                        return false;
+                    }
+                    _state = Symbol;
+                    return true;
+                }
+                symbol = decode(_distanceCode);
+                if(symbol == -1) {
+                    return false;
+                }
+                if(symbol < 0) {
+                    fail("invalid code length");
+                    return false;
+                }
+                if(symbol < 16) {
+                    _lengths[_index++] = symbol;
+                }
+                else {
+                    if(symbol == 16 && _index == 0) {
+                        fail("repeat without a previous length");
+                        return false;
+                    }
+                    _symbol = symbol;
+                    _state = CodeLengthRepeat;
+                }
+                return true;
+            case CodeLengthRepeat: {
+                uint8_t extra = _symbol == 16 ? 2 : (_symbol == 17 ? 3 : 7);
+                if(_bitCount < extra) {
+                    return false;
+                }
+                uint16_t repeat = take(extra) + (_symbol == 18 ? 11 : 3);
+                uint8_t length = _symbol == 16 ? _lengths[_index - 1] : 0;
+                if(_index + repeat > _literals + _distances) {
+                    fail("too many code lengths");
+                    return false;
+                }
+                while(repeat-- > 0) {
+                    _lengths[_index++] = length;
+                }
+                _state = CodeLengths;
+                return true;
+            }
+            case Symbol:
+                symbol = decode(_literalCode);
+                if(symbol == -1) {
+                    return false;
+                }
+                if(symbol < 0 || symbol > 285) {
+                    fail("invalid literal/length code");
+                    return false;
+                }
+                if(symbol < 256) {
+                    output(symbol);
+                }
+                else if(symbol == 256) { // end of block
+                    if(_final) {
+                        endOfStream();
+                    }
+                    else {
+                        _state = BlockHeader;
+                    }
+                }
+                else {
+                    _length = lengthBase[symbol - 257];
+                    _extra = lengthExtra[symbol - 257];
+                    _state = LengthExtra;
+                }
+                return true;
+            case LengthExtra:
+                if(_bitCount < _extra) {
+                    return false;
+                }
+                _length += take(_extra);
+                _state = Distance;
+                return true;
+            case Distance:
+                symbol = decode(_distanceCode);
+                if(symbol == -1) {
+                    return false;
+                }
+                if(symbol < 0 || symbol > 29) {
+                    fail("invalid distance code");
+                    return false;
+                }
+                _distance = distanceBase[symbol];
+                _extra = distanceExtra[symbol];
+                _state = DistanceExtra;
+                return true;
+            case DistanceExtra:
+                if(_bitCount < _extra) {
+                    return false;
+                }
+                _distance += take(_extra);
+                if(_distance > WINDOW) {
+                    fail("distance beyond the inflater window");
+                    return false;
+                }
+                if(_distance > _total) {
+                    fail("distance before the start of the stream");
+                    return false;
+                }
+                while(_length-- > 0) {
+                    output(_window[(_total - _distance) & (WINDOW - 1)]);
+                }
+                _state = Symbol;
+                return true;
+            default:
+                return false;
+        }
+    };
+
+  public:
+    Inflater() : _output(NULL), _state(Done), _error(NULL) {}
+
+    // Starts a new stream : the inflated bytes are written to 'output'
+    void begin(InflateFormat format, Print* output) {
+        _output = output;
+        _format = format;
+        _state = format == InflateRaw ? BlockHeader : Header;
+        _bits = 0;
+        _bitCount = 0;
+        _final = false;
+        _headerPos = 0;
+        _skip = 0;
+        _flags = 0;
+        _check = format == InflateGzip ? 0xFFFFFFFF : 1;
+        _total = 0;
+        _error = NULL;
+    };
+
+    using Print::write;
+    virtual size_t write(uint8_t c) {
+        if(_state == Failed) {
+            return 0;
+        }
+        if(_state == Done) {
+            return 1; // ignore what follows the stream
+        }
+        if(_state == Header) {
+            header(c);
+            return _state == Failed ? 0 : 1;
+        }
+        if(_state == Trailer) {
+            trailer(c);
+            return _state == Failed ? 0 : 1;
+        }
+        _bits |= (uint32_t)c << _bitCount;
+        _bitCount += 8;
+        while(step());
+        // Whole bytes left in the accumulator at the end of the deflate stream
+        while(_state == Trailer && _bitCount >= 8) {
+            trailer(take(8));
+        }
+        return _state == Failed ? 0 : 1;
+    };
+
+    // The whole stream has been decoded (and its checksum verified)
+    bool finished() {
+        return _state == Done;
+    };
+    // Reason of the failure, or NULL
+    const char* error() {
+        return _error;
+    };
+    // Inflated bytes of the current stream
+    uint32_t total() {
+        return _total;
+    };
+};
+
+#endif
@@ -0,0 +1,136 @@
+/**************************************************************************/
+/*!
+    @file     JsonArraySplitter.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_JSON_ARRAY_SPLITTER_
+#define _CONSTELLATION_JSON_ARRAY_SPLITTER_
+
+#include <stddef.h>
+#include <Print.h>
+
+/*
+    Splits a JSON array of objects as its bytes are written (ex: a response read from the socket) :
+    each element is collected in the buffer and handed to the callback as soon as it's complete, then the buffer is reused.
+    The memory needed is set by the largest element, not by the whole array. Elements larger than the buffer are dropped.
+*/
+class JsonArraySplitter : public Print
+{
+  private:
+    char* _buffer;
+    size_t _capacity;
+    size_t _length;
+    uint8_t _depth;
+    bool _inString;
+    bool _escape;
+    bool _overflow;
+    uint16_t _count;
+    uint16_t _dropped;
+    void (*_callback)(void* context, char* element, size_t length);
+    void* _context;
+
+    void append(char c) {
+        if(_length + 1 < _capacity) {
+            _buffer[_length++] = c;
+        }
+        else {
+            _overflow = true;
+        }
+    };
+    void complete() {
+        if(_overflow) {
+            _dropped++;
+            return;
+        }
+        _buffer[_length] = '\0';
+        _count++;
+        _callback(_context, _buffer, _length);
+    };
+
+  public:
+    JsonArraySplitter(char* buffer, size_t capacity, void (*callback)(void* context, char* element, size_t length), void* context) :
+        _buffer(buffer), _capacity(capacity), _length(0), _depth(0), _inString(false), _escape(false), _overflow(false),
+        _count(0), _dropped(0), _callback(callback), _context(context) {}
+
+    using Print::write;
+    virtual size_t write(uint8_t c) {
+        if(_inString) {
+            append(c);
+            if(_escape) {
+                _escape = false;
+            }
+            else if(c == '\\') {
+                _escape = true;
+            }
+            else if(c == '"') {
+                _inString = false;
+            }
+            return 1;
+        }
+        switch(c) {
+            case '{':
+            case '[':
+                if(++_depth == 2) { // new element
+                    _length = 0;
+                    _overflow = false;
+                }
+                if(_depth >= 2) {
+                    append(c);
+                }
+                break;
+            case '}':
+            case ']':
+                if(_depth >= 2) {
+                    append(c);
+                    if(_depth == 2) {
+                        complete();
+                    }
+                }
+                if(_depth > 0) {
+                    _depth--;
+                }
+                break;
+            case '"':
+                if(_depth >= 2) {
+                    append(c);
+                    _inString = true;
+                }
+                break;
+            default:
+                if(_depth >= 2) {
+                    append(c);
+                }
+                break;
+        }
+        return 1;
+    };
+
+    // Elements handed to the callback
+    uint16_t count() {
+        return _count;
+    };
+    // Elements dropped because they don't fit in the buffer
+    uint16_t dropped() {
+        return _dropped;
+    };
+};
+
+#endif
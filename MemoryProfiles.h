@@ -0,0 +1,223 @@
+/**************************************************************************/
+/*!
+    @file     MemoryProfiles.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_MEMORY_PROFILES_
+#define _CONSTELLATION_MEMORY_PROFILES_
+
+#ifndef NETCLIENT_BUFFER_SIZE
+#define NETCLIENT_BUFFER_SIZE 256
+#endif
+#ifndef RESPONSE_READ_BUFFER_SIZE
+#define RESPONSE_READ_BUFFER_SIZE 128
+#endif
+#ifndef HTTP_HEADER_LINE_SIZE
+#define HTTP_HEADER_LINE_SIZE 64
+#endif
+#ifndef STRING_FORMAT_BUFFER
+#define STRING_FORMAT_BUFFER 1024
+#endif
+#ifndef LOG_FORMAT_BUFFER
+#define LOG_FORMAT_BUFFER STRING_FORMAT_BUFFER
+#endif
+#ifndef JSON_PARSER_BUFFER_SIZE
+#define JSON_PARSER_BUFFER_SIZE 2560
+#endif
+#ifndef DEFAULT_SUBSCRIPTION_LIMIT
+#define DEFAULT_SUBSCRIPTION_LIMIT 1
+#endif
+#ifndef RESPONSE_BUFFER_SIZE
+#define RESPONSE_BUFFER_SIZE 2048
+#endif
+#ifndef INCOMING_ITEM_SIZE
+#define INCOMING_ITEM_SIZE 1024
+#endif
+#ifndef INFLATE_WINDOW_SIZE
+#define INFLATE_WINDOW_SIZE 4096
+#endif
+#ifndef STATEOBJECT_CACHE_SIZE
+#define STATEOBJECT_CACHE_SIZE 0
+#endif
+#ifndef CONSTELLATION_LOG_LEVEL
+#define CONSTELLATION_LOG_LEVEL Trace
+#endif
+#ifndef INBOUND_RING_SIZE
+#define INBOUND_RING_SIZE 0
+#endif
+#ifndef DEDUP_MESSAGES
+#define DEDUP_MESSAGES 0
+#endif
+#ifndef DEDUP_STATEOBJECTS
+#define DEDUP_STATEOBJECTS 0
+#endif
+#ifndef DEDUP_WINDOW
+#define DEDUP_WINDOW 5000
+#endif
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 0
+#endif
+#ifndef JSON_WRITER_BUFFER_SIZE
+#define JSON_WRITER_BUFFER_SIZE 1024
+#endif
+// Stack of loop() on the target (Arduino cores : loop task of the ESP32, system stack of the ESP8266, RAM of the AVR)
+#ifndef CONSTELLATION_STACK_SIZE
+#if defined(ESP8266)
+#define CONSTELLATION_STACK_SIZE 4096
+#elif defined(ESP32)
+#define CONSTELLATION_STACK_SIZE 8192
+#elif defined(ARDUINO_ARCH_AVR)
+#define CONSTELLATION_STACK_SIZE (RAMEND - RAMSTART + 1)
+#else
+#define CONSTELLATION_STACK_SIZE 65536
+#endif
+#endif
+
+/*
+    A memory profile is the second template parameter of Constellation<TNetworkClass, TProfile>.
+    It sets, at compile time, every buffer size, container capacity and feature toggle of the library :
+
+        Constellation<WiFiClient, TinyProfile> constellation(...);
+
+    To create your own profile, inherit from one of the profiles below and hide the values to change :
+
+        struct MyProfile : public DefaultProfile {
+            static const size_t JsonParserBufferSize = 4096;
+        };
+*/
+
+// Default sizes, driven by the historical macros (can be overridden before including Constellation.h)
+struct DefaultProfile {
+    static const size_t NetClientBufferSize = NETCLIENT_BUFFER_SIZE;        // Outgoing request buffer (POST)
+    static const size_t ResponseReadBufferSize = RESPONSE_READ_BUFFER_SIZE; // Incoming response, read in blocks of this size (on stack)
+    static const size_t StringFormatBufferSize = STRING_FORMAT_BUFFER;      // Formatted messages, logs & message data
+    static const size_t LogBufferSize = LOG_FORMAT_BUFFER;                  // Serial debug output line
+    static const size_t JsonParserBufferSize = JSON_PARSER_BUFFER_SIZE;     // Parsing of an incoming message or StateObject (on stack)
+    static const size_t IncomingItemSize = INCOMING_ITEM_SIZE;              // Largest incoming message or StateObject, as JSON text
+    static const int DefaultSubscriptionLimit = DEFAULT_SUBSCRIPTION_LIMIT; // Max. messages or StateObjects per long-poll
+    static const bool EchoRequests = true;                                  // Echo the outgoing requests on Serial in Trace mode
+    static const DebugMode MinLogLevel = CONSTELLATION_LOG_LEVEL;           // Most verbose level compiled in (the calls above are removed)
+    static const size_t InboundRingSize = INBOUND_RING_SIZE;                // Messages read but not dispatched yet, as JSON text (0 = dispatched as read, see setDispatchBudget)
+    // Lossy : the messages have no id, the same one really sent twice within DedupWindow (ex: "Toggle") is dropped as well
+    static const int DedupMessages = DEDUP_MESSAGES;                        // Fingerprints of the last messages, 8 bytes each (0 = no duplicate detection)
+    static const int DedupStateObjects = DEDUP_STATEOBJECTS;                // StateObjects whose last LastUpdate is remembered, 8 bytes each (0 = none)
+    static const unsigned long DedupWindow = DEDUP_WINDOW;                  // The same message received again within this delay is a duplicate (ms)
+    static const int TraceSize = TRACE_SIZE;                                // Events of the binary trace, 12 bytes each (0 = disabled, see dumpTrace)
+    // Heap-free mode : every internal allocation comes from fixed, per-instance storage sized below (no compressed responses).
+    // Define DESCRIPTOR_MAX_MEMBERS before including Constellation.h to also have fixed-size descriptors.
+    static const bool HeapFree = false;
+    static const size_t ResponseBufferSize = RESPONSE_BUFFER_SIZE;          // Body of a response, for each of the 3 connections
+    static const size_t JsonWriterBufferSize = JSON_WRITER_BUFFER_SIZE;     // Largest outgoing JSON document (on stack)
+    static const int MaxMessageCallbacks = 16;                              // MessageCallbacks + pending saga callbacks
+    static const int MaxStateObjectLinks = 8;
+    static const int MaxTypeDescriptors = 8;
+    static const int MaxMessageGroups = 4;
+    static const int MaxTrackedStateObjects = 8;                            // StateObjects remembered by the delta publishing
+    static const size_t StateObjectCacheSize = STATEOBJECT_CACHE_SIZE;      // Local copy of the received StateObjects (0 = disabled, see getCachedStateObject)
+    static const int MaxTasks = 8;                                          // Tasks of the built-in scheduler
+    static const int MaxTasksPerTick = 4;                                   // Max. due tasks run between two steps of loop()
+    static const int MaxPublishers = 4;                                     // StateObjects pushed on a schedule (see publishStateObject)
+    static const unsigned long ConnectionMaxIdle = 30000;                   // Idle request connection reopened before use (ms)
+    static const size_t InflateWindowSize = INFLATE_WINDOW_SIZE;            // Largest compression window of the responses (see setCompression)
+    // Network task mode (ESP32 & Linux, see startNetworkTask)
+    static const unsigned int NetworkQueueLength = 4;                       // Slots of the inbound & the bulk outbound queues (power of 2)
+    static const size_t InboundSlotSize = 1024;                             // Largest incoming message or StateObject
+    static const unsigned int InteractiveQueueLength = 2;                   // Slots of the outbound lane of the messages & saga responses (power of 2)
+    static const size_t OutboundSlotSize = 1024;                            // Largest outgoing request (headers included)
+    static const unsigned long OutboundAgingLimit = 250;                    // Queued bulk request sent ahead of the interactive lane after this wait (ms)
+    static const uint32_t NetworkTaskStackSize = 8192;
+    static const int NetworkTaskCore = 0;                                   // ESP32 : the core of the WiFi stack
+    static const size_t StackSize = CONSTELLATION_STACK_SIZE;               // Stack of loop() on the target (see MemoryFootprint::StackFits)
+};
+
+// Default sizes without any heap allocation (long-running nodes)
+struct HeapFreeProfile : public DefaultProfile {
+    static const bool HeapFree = true;
+};
+
+// Small AVR boards (Leonardo, Mega, ...) : small batches & buffers, no request echo. About 1.6 KB of buffers (see MemoryFootprint)
+// and 0.5 KB of state for an instance : too much for the 2 KB of an Uno. The incoming items are limited to 192 bytes of JSON
+// and the answers read in full (getSettings, requestStateObjects) to 96 bytes.
+struct TinyProfile : public DefaultProfile {
+    static const size_t NetClientBufferSize = 64;
+    static const size_t ResponseReadBufferSize = 32;
+    static const size_t StringFormatBufferSize = 96;
+    static const size_t LogBufferSize = 64;
+    static const size_t JsonParserBufferSize = 256;
+    static const size_t IncomingItemSize = 192;
+    static const int DefaultSubscriptionLimit = 1;
+    static const bool EchoRequests = false;
+    static const DebugMode MinLogLevel = Error;
+    static const bool HeapFree = true;
+    static const size_t ResponseBufferSize = 96;
+    static const size_t JsonWriterBufferSize = 192;
+    static const int MaxMessageCallbacks = 3;
+    static const int MaxStateObjectLinks = 2;
+    static const int MaxTypeDescriptors = 2;
+    static const int MaxMessageGroups = 1;
+    static const int MaxTrackedStateObjects = 2;
+    static const int MaxTasks = 2;
+    static const int MaxTasksPerTick = 1;
+    static const int MaxPublishers = 1;
+};
+
+// Boards with plenty of RAM (ESP32, Linux gateways, ...) : bigger batches & segments
+struct LargeProfile : public DefaultProfile {
+    static const size_t NetClientBufferSize = 1024;
+    static const size_t ResponseReadBufferSize = 536;                       // a TCP segment
+    static const size_t StringFormatBufferSize = 2048;
+    static const size_t LogBufferSize = 512;
+    static const size_t JsonParserBufferSize = 8192;
+    static const size_t IncomingItemSize = 4096;
+    static const int DefaultSubscriptionLimit = 10;
+    static const int MaxTrackedStateObjects = 32;
+    static const size_t StateObjectCacheSize = 8192;
+    static const size_t InboundRingSize = 8192;
+    static const int DedupStateObjects = 32;
+    static const int TraceSize = 256;
+    static const int MaxTasks = 16;
+    static const int MaxTasksPerTick = 8;
+    static const int MaxPublishers = 8;
+    static const unsigned int NetworkQueueLength = 8;
+    static const unsigned int InteractiveQueueLength = 4;
+    static const size_t InboundSlotSize = 4096;
+    static const size_t OutboundSlotSize = 2048;
+    static const size_t InflateWindowSize = 32768;                          // any server (default zlib window)
+};
+
+// Worst-case RAM taken by the library buffers for a profile (the network clients are not included)
+template<typename TProfile>
+struct MemoryFootprint {
+    // Buffers owned by each Constellation instance
+    static const size_t InstanceBuffers = TProfile::NetClientBufferSize + TProfile::IncomingItemSize + TProfile::StateObjectCacheSize + TProfile::InboundRingSize + (TProfile::DedupMessages + TProfile::DedupStateObjects) * 8 + TProfile::TraceSize * 12 + (TProfile::HeapFree ? 3 * TProfile::ResponseBufferSize : 0);
+    // Buffers shared by all the instances using this profile
+    static const size_t SharedBuffers = TProfile::StringFormatBufferSize + TProfile::LogBufferSize;
+    // Largest buffers taken on the stack : the reading & parsing of an incoming item, and a callback sending a request
+    // meanwhile (ex: requestStateObjects, the same chain again) or pushing a StateObject
+    static const size_t ResponseStack = TProfile::ResponseReadBufferSize + HTTP_HEADER_LINE_SIZE + TProfile::JsonParserBufferSize;
+    static const size_t PeakStack = 2 * ResponseStack + (TProfile::HeapFree ? TProfile::JsonWriterBufferSize : 0);
+    static const size_t WorstCase = InstanceBuffers + SharedBuffers + PeakStack;
+    // False if the profile can overflow the stack of loop() (ex: the DefaultProfile on ESP8266) :
+    //  static_assert(MemoryFootprint<MyProfile>::StackFits, "smaller JsonParserBufferSize needed");
+    static const bool StackFits = PeakStack <= TProfile::StackSize;
+};
+
+#endif
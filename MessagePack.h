@@ -0,0 +1,428 @@
+/**************************************************************************/
+/*!
+    @file     MessagePack.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_MESSAGEPACK_
+#define _CONSTELLATION_MESSAGEPACK_
+
+#include <math.h>
+#include <string.h>
+#include <Print.h>
+#include <ArduinoJson.h>
+
+#define MESSAGEPACK_CONTENT_TYPE "application/x-msgpack"
+#define MESSAGEPACK_NESTING_LIMIT 10
+
+/*
+    MessagePack (compact binary JSON) encoding of the StateObjects & messages.
+    MessagePackWriter writes a JSON document (or single values) on a Print.
+    MessagePackReader decodes in place : the strings stay in the input buffer (moved back over their header
+    and NUL-terminated), so the JSON document built by toJson() doesn't copy anything.
+*/
+
+enum MessagePackType : uint8_t {
+    MessagePackNil = 0,
+    MessagePackBool = 1,
+    MessagePackInteger = 2,
+    MessagePackFloat = 3,
+    MessagePackString = 4,
+    MessagePackArray = 5,
+    MessagePackMap = 6,
+    MessagePackError = 7
+};
+
+typedef struct {
+    MessagePackType type;
+    union {
+        bool boolean;
+        int64_t integer;
+        double real;
+        const char* string;
+    };
+    uint32_t size;              // length of a string, items of an array, pairs of a map
+} MessagePackToken;
+
+// Counts the bytes written (to compute a Content-Length)
+class LengthPrint : public Print
+{
+  private:
+    size_t _length;
+
+  public:
+    LengthPrint() : _length(0) {}
+
+    using Print::write;
+    virtual size_t write(uint8_t) {
+        _length++;
+        return 1;
+    };
+    virtual size_t write(const uint8_t*, size_t size) {
+        _length += size;
+        return size;
+    };
+    size_t length() {
+        return _length;
+    };
+};
+
+class MessagePackWriter
+{
+  private:
+    Print& _out;
+
+    size_t writeHeader(uint8_t type, uint32_t value, uint8_t size) {
+        uint8_t header[5] = { type };
+        for(uint8_t i = 0; i < size; i++) {
+            header[size - i] = (uint8_t)(value >> (8 * i));
+        }
+        return _out.write(header, size + 1);
+    };
+    // 64 bits value : the high half in the header, then the low half
+    size_t writeHeader64(uint8_t type, uint64_t value) {
+        uint8_t low[4];
+        for(uint8_t i = 0; i < 4; i++) {
+            low[3 - i] = (uint8_t)(value >> (8 * i));
+        }
+        return writeHeader(type, (uint32_t)(value >> 32), 4) + _out.write(low, 4);
+    };
+    // fix format if it fits in 'fixMax', otherwise the 8, 16 or 32 bits variant (type8 = 0 when there's no 8 bits variant)
+    size_t writeLength(uint8_t fixType, uint32_t fixMax, uint8_t type8, uint8_t type16, uint8_t type32, uint32_t length) {
+        if(length <= fixMax) {
+            return writeHeader(fixType | (uint8_t)length, 0, 0);
+        }
+        if(type8 != 0 && length <= 0xFF) {
+            return writeHeader(type8, length, 1);
+        }
+        if(length <= 0xFFFF) {
+            return writeHeader(type16, length, 2);
+        }
+        return writeHeader(type32, length, 4);
+    };
+
+  public:
+    MessagePackWriter(Print& out) : _out(out) {}
+
+    size_t writeNil() {
+        return _out.write((uint8_t)0xC0);
+    };
+    size_t writeBool(bool value) {
+        return _out.write((uint8_t)(value ? 0xC3 : 0xC2));
+    };
+    // Smallest encoding of the value : 64 bits only beyond the 32 bits range
+    size_t writeInteger(int64_t value) {
+        if(value >= -32 && value <= 127) {
+            return _out.write((uint8_t)value); // positive & negative fixint
+        }
+        if(value > 0) {
+            if(value > 0xFFFFFFFFLL) {
+                return writeHeader64(0xCF, value);
+            }
+            return value <= 0xFF ? writeHeader(0xCC, value, 1) : (value <= 0xFFFF ? writeHeader(0xCD, value, 2) : writeHeader(0xCE, value, 4));
+        }
+        if(value < -2147483647LL - 1) {
+            return writeHeader64(0xD3, value);
+        }
+        return value >= -128 ? writeHeader(0xD0, value, 1) : (value >= -32768 ? writeHeader(0xD1, value, 2) : writeHeader(0xD2, value, 4));
+    };
+    size_t writeFloat(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return writeHeader(0xCA, bits, 4);
+    };
+    // float32 when it keeps the value (always on AVR, where double is float), float64 otherwise
+    size_t writeDouble(double value) {
+        if(sizeof(double) < 8 || (double)(float)value == value || value != value) {
+            return writeFloat(value);
+        }
+        uint64_t bits = 0;
+        memcpy(&bits, &value, sizeof(value));
+        return writeHeader64(0xCB, bits);
+    };
+    size_t writeString(const char* value) {
+        uint32_t length = strlen(value);
+        return writeLength(0xA0, 31, 0xD9, 0xDA, 0xDB, length) + _out.write((const uint8_t*)value, length);
+    };
+    size_t writeArrayHeader(uint32_t size) {
+        return writeLength(0x90, 15, 0, 0xDC, 0xDD, size);
+    };
+    size_t writeMapHeader(uint32_t size) {
+        return writeLength(0x80, 15, 0, 0xDE, 0xDF, size);
+    };
+
+    size_t write(JsonObject& object) {
+        size_t length = writeMapHeader(object.size());
+        for(JsonPair& pair : object) {
+            length += writeString(pair.key);
+            length += write(pair.value);
+        }
+        return length;
+    };
+    size_t write(JsonArray& array) {
+        size_t length = writeArrayHeader(array.size());
+        for(JsonVariant item : array) {
+            length += write(item);
+        }
+        return length;
+    };
+    size_t write(const JsonVariant& value) {
+        if(value.is<JsonObject&>()) {
+            return write(value.as<JsonObject&>());
+        }
+        if(value.is<JsonArray&>()) {
+            return write(value.as<JsonArray&>());
+        }
+        if(value.is<bool>()) {
+            return writeBool(value.as<bool>());
+        }
+        if(value.is<long>()) {
+            return writeInteger(value.as<int64_t>());
+        }
+        if(value.is<double>()) {
+            return writeDouble(value.as<double>());
+        }
+        if(value.is<const char*>()) {
+            return writeString(value.as<const char*>());
+        }
+        return writeNil();
+    };
+
+    template<typename T>
+    static size_t measure(T& document) {
+        LengthPrint length;
+        MessagePackWriter(length).write(document);
+        return length.length();
+    };
+};
+
+class MessagePackReader
+{
+  private:
+    uint8_t* _data;
+    size_t _size;
+    size_t _position;
+    bool _error;
+
+    bool available(uint32_t size) {
+        return _size - _position >= size;
+    };
+    uint32_t readUnsigned(uint8_t size) {
+        uint32_t value = 0;
+        for(uint8_t i = 0; i < size; i++) {
+            value = (value << 8) | _data[_position++];
+        }
+        return value;
+    };
+    static double toDouble(uint32_t high, uint32_t low) {
+        int exponent = (high >> 20) & 0x7FF;
+        double mantissa = ldexp((double)(high & 0xFFFFF), 32) + low;
+        double value = exponent == 0 ? ldexp(mantissa, -1074) : ldexp(mantissa + ldexp(1.0, 52), exponent - 1075);
+        return (high & 0x80000000) ? -value : value;
+    };
+    bool fail(MessagePackToken& token) {
+        token.type = MessagePackError;
+        _error = true;
+        return false;
+    };
+    JsonVariant invalid() {
+        _error = true;
+        _position = _size;
+        return JsonVariant();
+    };
+
+  public:
+    MessagePackReader(uint8_t* data, size_t size) : _data(data), _size(size), _position(0), _error(false) {}
+
+    bool error() {
+        return _error;
+    };
+
+    // Reads the next token (arrays & maps : only the header, then read their items). Returns false at the end or on error.
+    bool next(MessagePackToken& token) {
+        if(!available(1)) {
+            return fail(token);
+        }
+        size_t start = _position;
+        uint8_t type = _data[_position++];
+        uint8_t lengthSize = 0;
+        token.size = 0;
+        if(type <= 0x7F || type >= 0xE0) {
+            token.type = MessagePackInteger;
+            token.integer = type <= 0x7F ? (long)type : (long)(int8_t)type;
+            return true;
+        }
+        if((type & 0xF0) == 0x80 || (type & 0xF0) == 0x90) {
+            token.type = (type & 0xF0) == 0x80 ? MessagePackMap : MessagePackArray;
+            token.size = type & 0x0F;
+            return true;
+        }
+        if((type & 0xE0) == 0xA0) {
+            token.size = type & 0x1F;
+        }
+        else {
+            static const uint8_t sizes[] = { 1, 2, 4, 8 };
+            switch(type) {
+                case 0xC0:
+                    token.type = MessagePackNil;
+                    return true;
+                case 0xC2:
+                case 0xC3:
+                    token.type = MessagePackBool;
+                    token.boolean = type == 0xC3;
+                    return true;
+                case 0xCA:
+                case 0xCB: {
+                    if(!available(type == 0xCA ? 4 : 8)) {
+                        return fail(token);
+                    }
+                    token.type = MessagePackFloat;
+                    if(type == 0xCA) {
+                        uint32_t bits = readUnsigned(4);
+                        float value;
+                        memcpy(&value, &bits, sizeof(value));
+                        token.real = value;
+                    }
+                    else {
+                        uint32_t high = readUnsigned(4);
+                        token.real = toDouble(high, readUnsigned(4));
+                    }
+                    return true;
+                }
+                case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+                case 0xD0: case 0xD1: case 0xD2: case 0xD3: {
+                    uint8_t size = sizes[type & 0x03];
+                    if(!available(size)) {
+                        return fail(token);
+                    }
+                    token.type = MessagePackInteger;
+                    if(size == 8) {
+                        uint32_t high = readUnsigned(4);
+                        uint64_t value = ((uint64_t)high << 32) | readUnsigned(4);
+                        if(type == 0xCF && (value >> 63) != 0) {
+                            // Beyond int64 : approximated
+                            token.type = MessagePackFloat;
+                            token.real = ldexp((double)high, 32) + (double)(uint32_t)value;
+                        }
+                        else {
+                            token.integer = (int64_t)value;
+                        }
+                        return true;
+                    }
+                    uint32_t value = readUnsigned(size);
+                    if(type >= 0xD0) {
+                        token.integer = size == 1 ? (int8_t)value : (size == 2 ? (int16_t)value : (int32_t)value);
+                    }
+                    else {
+                        token.integer = value;
+                    }
+                    return true;
+                }
+                case 0xD9: case 0xDA: case 0xDB:
+                    lengthSize = sizes[type - 0xD9];
+                    break;
+                case 0xDC: case 0xDD:
+                case 0xDE: case 0xDF:
+                    if(!available(type & 0x01 ? 4 : 2)) {
+                        return fail(token);
+                    }
+                    token.type = type <= 0xDD ? MessagePackArray : MessagePackMap;
+                    token.size = readUnsigned(type & 0x01 ? 4 : 2);
+                    return true;
+                default: // bin, ext, ...
+                    return fail(token);
+            }
+            if(!available(lengthSize)) {
+                return fail(token);
+            }
+            token.size = readUnsigned(lengthSize);
+        }
+        // String : moved back over its header to make room for the NUL
+        if(!available(token.size)) {
+            return fail(token);
+        }
+        char* string = (char*)_data + start;
+        memmove(string, _data + _position, token.size);
+        string[token.size] = '\0';
+        _position += token.size;
+        token.type = MessagePackString;
+        token.string = string;
+        return true;
+    };
+
+    // Builds the JSON document of the next value (strings are not copied)
+    JsonVariant toJson(JsonBuffer& buffer, uint8_t nestingLimit = MESSAGEPACK_NESTING_LIMIT) {
+        MessagePackToken token;
+        if(!next(token)) {
+            return JsonVariant();
+        }
+        switch(token.type) {
+            case MessagePackBool:
+                return token.boolean;
+            case MessagePackInteger:
+                // Beyond the integers of the board (long) : approximated
+                if((long)token.integer != token.integer) {
+                    return (double)token.integer;
+                }
+                return (long)token.integer;
+            case MessagePackFloat:
+                return token.real;
+            case MessagePackString:
+                return token.string;
+            case MessagePackArray: {
+                JsonArray& array = nestingLimit > 0 ? buffer.createArray() : JsonArray::invalid();
+                if(!array.success()) {
+                    return invalid();
+                }
+                for(uint32_t i = 0; i < token.size; i++) {
+                    // An item missing (truncated input) is an error
+                    JsonVariant item = toJson(buffer, nestingLimit - 1);
+                    if(_error) {
+                        return invalid();
+                    }
+                    array.add(item);
+                }
+                return array;
+            }
+            case MessagePackMap: {
+                JsonObject& object = nestingLimit > 0 ? buffer.createObject() : JsonObject::invalid();
+                if(!object.success()) {
+                    return invalid();
+                }
+                for(uint32_t i = 0; i < token.size; i++) {
+                    MessagePackToken key;
+                    if(!next(key) || key.type != MessagePackString) {
+                        return invalid();
+                    }
+                    JsonVariant value = toJson(buffer, nestingLimit - 1);
+                    if(_error) {
+                        return invalid();
+                    }
+                    object.set(key.string, value);
+                }
+                return object;
+            }
+            default:
+                return JsonVariant();
+        }
+    };
+};
+
+#endif
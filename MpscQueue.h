@@ -0,0 +1,93 @@
+/**************************************************************************/
+/*!
+    @file     MpscQueue.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_MPSC_QUEUE_
+#define _CONSTELLATION_MPSC_QUEUE_
+
+#include <stddef.h>
+#include <atomic>
+
+/*
+    Bounded lock-free queue between several producers (ex: worker threads) and one consumer.
+    Each slot has a sequence number telling whether it is free, being filled or ready to read.
+    Same in-place API as SpscQueue : reserve() / commit(slot) for the producers, front() / release() for the consumer.
+*/
+template<typename T, unsigned int CAPACITY>
+class MpscQueue
+{
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "The capacity of the queue must be a power of 2");
+
+  private:
+    T _slots[CAPACITY];
+    std::atomic<unsigned int> _sequences[CAPACITY];
+    std::atomic<unsigned int> _tail;    // next position to reserve (producers)
+    unsigned int _head;                 // next position to read (consumer only)
+
+  public:
+    MpscQueue() : _tail(0), _head(0) {
+        for(unsigned int i = 0; i < CAPACITY; i++) {
+            _sequences[i].store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer : returns a free slot, or NULL if the queue is full
+    T* reserve() {
+        unsigned int position = _tail.load(std::memory_order_relaxed);
+        while(true) {
+            unsigned int index = position & (CAPACITY - 1);
+            int diff = (int)(_sequences[index].load(std::memory_order_acquire) - position);
+            if(diff == 0) {
+                if(_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return &_slots[index];
+                }
+            }
+            else if(diff < 0) {
+                return NULL;
+            }
+            else {
+                position = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    };
+    // Producer : publishes a slot returned by reserve()
+    void commit(T* slot) {
+        unsigned int index = slot - _slots;
+        _sequences[index].store(_sequences[index].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    };
+
+    // Consumer : returns the oldest slot, or NULL if it is empty or still being filled
+    T* front() {
+        unsigned int index = _head & (CAPACITY - 1);
+        if(_sequences[index].load(std::memory_order_acquire) != _head + 1) {
+            return NULL;
+        }
+        return &_slots[index];
+    };
+    // Consumer : gives the slot returned by front() back to the producers
+    void release() {
+        _sequences[_head & (CAPACITY - 1)].store(_head + CAPACITY, std::memory_order_release);
+        _head++;
+    };
+};
+
+#endif
@@ -45,9 +45,36 @@ class TypeDescriptorBase
   private:
     const char* _description;
     bool _isHidden;
-    LinkedList<MemberInfo> *_members = new LinkedList<MemberInfo>();
+#ifdef DESCRIPTOR_MAX_MEMBERS
+    // Fixed-size storage, the descriptor is copied by value (heap-free mode)
+    StaticList<MemberInfo, DESCRIPTOR_MAX_MEMBERS> _members;
+    int memberCount() {
+        return this->_members.size();
+    };
+    MemberInfo& getMember(int index) {
+        return this->_members.get(index);
+    };
+    bool addMemberInfo(MemberInfo member) {
+        return this->_members.add(member);
+    };
+#else
+    // Allocated on the first member only : empty descriptors (hidden callbacks, sagas) don't touch the heap
+    LinkedList<MemberInfo> *_members = NULL;
+    int memberCount() {
+        return this->_members != NULL ? this->_members->size() : 0;
+    };
+    MemberInfo getMember(int index) {
+        return this->_members->get(index);
+    };
+    bool addMemberInfo(MemberInfo member) {
+        if(this->_members == NULL) {
+            this->_members = new LinkedList<MemberInfo>();
+        }
+        return this->_members->add(member);
+    };
+#endif
     
-  protected:
+  public:
     template<typename TParam>
     const char* getTypename() {
         if (std::is_same<TParam, bool>::value) {
@@ -82,15 +109,14 @@ class TypeDescriptorBase
         }
     };
 
-  public:
     virtual void fillJsonObject(JsonObject& mcObject) = 0;
     void fillJsonObject(JsonObject& mcObject, uint8_t memberType) {
         if(this->_description != NULL) {
             mcObject["Description"] = this->_description;
         }
         JsonArray& parameters = mcObject.createNestedArray(memberType == PARAMETER_TYPE ? "Parameters" : "Properties");
-        for(int i = 0; i < this->_members->size(); i++) {
-            MemberInfo member = this->_members->get(i);
+        for(int i = 0; i < memberCount(); i++) {
+            MemberInfo member = getMember(i);
             JsonObject& parameterObject = parameters.createNestedObject();
             parameterObject["Name"] = member.name;
             parameterObject["TypeName"] = member.type;
@@ -125,6 +151,13 @@ class TypeDescriptorBase
         return this->_isHidden;
     }
 
+    int getMemberCount() {
+        return memberCount();
+    };
+    MemberInfo getMemberInfo(int index) {
+        return getMember(index);
+    };
+
     T& addOptionalMember(const char * name, JsonVariant defaultValue, const char * description) {
         if(defaultValue.is<bool>()) {
             return addMember(name, "System.Boolean", defaultValue, description);
@@ -174,7 +207,7 @@ class TypeDescriptorBase
         member.description = description;
         member.isOptional = isOptional;
         member.defaultValue = defaultValue;
-        this->_members->add(member);
+        addMemberInfo(member);
         return (T&)*this;
     };
 };
@@ -0,0 +1,124 @@
+/**************************************************************************/
+/*!
+    @file     ResponseReader.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_RESPONSE_READER_
+#define _CONSTELLATION_RESPONSE_READER_
+
+#include <Arduino.h>
+#include <Print.h>
+#include "TextScan.h"
+
+/*
+    Reads an HTTP response through a buffer of SIZE bytes, filled with what the client has received in one read() :
+    the header lines are split with findNewline and the body goes to its Print in blocks, instead of a virtual call
+    to the client (and a timed wait for Stream::readBytesUntil) per byte.
+    The connections are not pipelined : the bytes read ahead all belong to the response being read.
+*/
+template<typename TClient, size_t SIZE>
+class ResponseReader
+{
+  private:
+    TClient* _client;
+    unsigned long _timeout;         // ms to wait for the rest of a line
+    uint8_t _buffer[SIZE];
+    size_t _start;                  // first byte not consumed
+    size_t _end;
+
+    // Refills the empty buffer, waiting up to the timeout for the next bytes if 'wait'
+    bool fill(bool wait) {
+        if(_start < _end) {
+            return true;
+        }
+        _start = _end = 0;
+        unsigned long start = millis();
+        while(true) {
+            int available = _client->available();
+            if(available > 0) {
+                int count = _client->read(_buffer, (size_t)available < SIZE ? (size_t)available : SIZE);
+                if(count > 0) {
+                    _end = count;
+                    return true;
+                }
+            }
+            if(!wait || !_client->connected() || millis() - start >= _timeout) {
+                return false;
+            }
+            yield();
+        }
+    };
+
+  public:
+    ResponseReader(TClient* client, unsigned long timeout) : _client(client), _timeout(timeout), _start(0), _end(0) {}
+
+    // Bytes buffered or received
+    bool available() {
+        return _start < _end || _client->available() > 0;
+    };
+
+    // Reads a line in a fixed buffer (the end of a too long line is skipped) and trims it
+    size_t readLine(char* line, size_t size) {
+        size_t length = 0;
+        while(fill(true)) {
+            const uint8_t* begin = _buffer + _start;
+            const uint8_t* newline = findNewline(begin, _end - _start);
+            size_t count = (newline != NULL ? newline : _buffer + _end) - begin;
+            size_t copied = count < size - 1 - length ? count : size - 1 - length;
+            memcpy(line + length, begin, copied);
+            length += copied;
+            _start += count;
+            if(newline != NULL) {
+                _start++;
+                break;
+            }
+        }
+        while(length > 0 && isspace((unsigned char)line[length - 1])) {
+            length--;
+        }
+        line[length] = '\0';
+        return length;
+    };
+
+    // Writes up to 'max' bytes already received to 'out' in one block, returns the count (0 if none)
+    size_t readTo(Print& out, size_t max) {
+        if(!fill(false)) {
+            return 0;
+        }
+        size_t count = _end - _start < max ? _end - _start : max;
+        out.write(_buffer + _start, count);
+        _start += count;
+        return count;
+    };
+
+    // Consumes the expected bytes (ex: the CR LF after a chunk), waiting up to the timeout for them
+    bool skip(const char* expected) {
+        for(; *expected != '\0'; expected++) {
+            if(!fill(true) || _buffer[_start] != (uint8_t)*expected) {
+                return false;
+            }
+            _start++;
+        }
+        return true;
+    };
+};
+
+#endif
@@ -0,0 +1,281 @@
+/**************************************************************************/
+/*!
+    @file     SimClient.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_SIM_CLIENT_
+#define _CONSTELLATION_SIM_CLIENT_
+
+#include <Arduino.h>
+#include <Client.h>
+
+/*
+    Simulated network for benchmarks without a real network : Constellation<SimClient> talks to an in-process server
+    (a handler writing the raw HTTP responses) through a link with the conditions below. The faults happen at fixed
+    request or connection counts and the jitter comes from a seeded generator, so two runs see the same network.
+    The simulation only uses the Arduino API : it runs on the host (with an Arduino core emulation) as well as on a board.
+
+        SimNetwork::instance().begin(handler, NULL, conditions);
+        Constellation<SimClient> constellation("sim", 8088, "Sentinel", "Package", "Key");
+*/
+
+// Conditions of the simulated link (delays in ms, 0 = disabled)
+typedef struct {
+    unsigned long connectTime;      // to establish a connection
+    unsigned long rtt;              // from the end of a request to the first byte of its response
+    unsigned long jitter;           // random extra delay (0 to jitter) added to the RTT
+    uint32_t bandwidth;             // bytes/s of the responses (0 = unlimited)
+    size_t chunkSize;               // the responses arrive in chunks of chunkSize bytes ...
+    unsigned long chunkGap;         // ... one every chunkGap ms
+    size_t maxAvailable;            // max bytes reported by available() (1 = one byte at a time)
+    uint16_t refuseEvery;           // every N-th connection is refused
+    uint16_t resetEvery;            // every N-th request, the server resets the connection instead of answering
+    uint16_t halfOpenEvery;         // every N-th request, the connection stays open but never answers
+} SimConditions;
+
+typedef struct {
+    uint32_t connects;
+    uint32_t refused;
+    uint32_t requests;
+    uint32_t resets;
+    uint32_t halfOpen;
+    uint32_t bytesSent;             // by the clients
+    uint32_t bytesReceived;         // by the clients
+} SimStats;
+
+// Writes the raw HTTP response to 'request' (status line, headers & body) and returns the extra time (ms) the server
+// takes before answering (ex: a long-poll waiting for a message)
+typedef unsigned long (*SimHandler)(const char* request, Print& response, void* context);
+
+// The simulated server & link shared by all the SimClient instances
+class SimNetwork
+{
+  private:
+    uint32_t _random;
+
+  public:
+    SimHandler handler;
+    void* context;
+    SimConditions conditions;
+    SimStats stats;
+
+    static SimNetwork& instance() {
+        static SimNetwork network;
+        return network;
+    };
+
+    // Sets the server & the conditions, and restarts the counters & the random sequence
+    void begin(SimHandler handler, void* context, const SimConditions& conditions, uint32_t seed = 1) {
+        this->handler = handler;
+        this->context = context;
+        this->conditions = conditions;
+        memset(&stats, 0, sizeof(stats));
+        _random = seed != 0 ? seed : 1;
+    };
+
+    // xorshift32 : the same sequence for the same seed, on every platform
+    uint32_t nextRandom() {
+        _random ^= _random << 13;
+        _random ^= _random >> 17;
+        _random ^= _random << 5;
+        return _random;
+    };
+};
+
+class SimClient : public Client
+{
+  private:
+    // Print appending the response of the handler to the connection
+    class ResponseWriter : public Print {
+      public:
+        String& output;
+        ResponseWriter(String& output) : output(output) {}
+        using Print::write;
+        virtual size_t write(uint8_t c) {
+            output += (char)c;
+            return 1;
+        };
+    };
+
+    String _request;                // bytes written, until a whole request is received
+    String _response;               // bytes to read
+    size_t _position;               // next byte to read
+    size_t _released;               // bytes of the previous responses, all readable
+    unsigned long _readyAt;         // millis() of the first byte of the last response
+    bool _open;
+    bool _stalled;                  // half-open : the last response never comes
+
+    SimNetwork& network() {
+        return SimNetwork::instance();
+    };
+    // Bytes of _response that have reached the client by now
+    size_t arrived() {
+        unsigned long now = millis();
+        if(_stalled || (long)(now - _readyAt) < 0) {
+            return _released;
+        }
+        const SimConditions& conditions = network().conditions;
+        unsigned long elapsed = now - _readyAt;
+        size_t length = _response.length() - _released;
+        if(conditions.bandwidth > 0 && (uint64_t)elapsed * conditions.bandwidth / 1000 + 1 < length) {
+            length = (uint64_t)elapsed * conditions.bandwidth / 1000 + 1;
+        }
+        if(conditions.chunkSize > 0 && conditions.chunkGap > 0 && (elapsed / conditions.chunkGap + 1) * conditions.chunkSize < length) {
+            length = (elapsed / conditions.chunkGap + 1) * conditions.chunkSize;
+        }
+        return _released + length;
+    };
+    // Hands each complete request (headers & Content-Length body) to the server
+    void receiveRequests() {
+        int headerEnd;
+        while(true) {
+            // Blank lines between two requests (ex: after a body)
+            size_t skip = 0;
+            while(skip < _request.length() && (_request[skip] == '\r' || _request[skip] == '\n')) {
+                skip++;
+            }
+            _request.remove(0, skip);
+            if((headerEnd = _request.indexOf("\r\n\r\n")) < 0) {
+                return;
+            }
+            size_t length = headerEnd + 4;
+            int contentLength = _request.indexOf("Content-Length: ");
+            if(contentLength >= 0 && contentLength < headerEnd) {
+                length += _request.substring(contentLength + 16, headerEnd).toInt();
+            }
+            if(_request.length() < length) {
+                return;
+            }
+            String request = _request.substring(0, length);
+            _request.remove(0, length);
+            answer(request);
+        }
+    };
+    void answer(const String& request) {
+        SimNetwork& network = this->network();
+        uint32_t count = ++network.stats.requests;
+        if(network.conditions.resetEvery > 0 && count % network.conditions.resetEvery == 0) {
+            network.stats.resets++;
+            disconnect();
+            return;
+        }
+        // The response starts after the RTT (the bytes of the previous one not arrived yet come with it)
+        _released = arrived();
+        _response.remove(0, _position);
+        _released -= _position;
+        _position = 0;
+        _readyAt = millis() + network.conditions.rtt + (network.conditions.jitter > 0 ? network.nextRandom() % (network.conditions.jitter + 1) : 0);
+        if(network.conditions.halfOpenEvery > 0 && count % network.conditions.halfOpenEvery == 0) {
+            network.stats.halfOpen++;
+            _stalled = true;
+            return;
+        }
+        if(network.handler != NULL) {
+            ResponseWriter writer(_response);
+            _readyAt += network.handler(request.c_str(), writer, network.context);
+        }
+    };
+    void disconnect() {
+        _open = false;
+        _stalled = false;
+        _request = "";
+        _response = "";
+        _position = 0;
+        _released = 0;
+    };
+
+  public:
+    SimClient() : _position(0), _released(0), _readyAt(0), _open(false), _stalled(false) {}
+
+    virtual int connect(IPAddress ip, uint16_t port) {
+        return connect("", port);
+    };
+    virtual int connect(const char* host, uint16_t port) {
+        SimNetwork& network = this->network();
+        disconnect();
+        delay(network.conditions.connectTime);
+        if(network.conditions.refuseEvery > 0 && (network.stats.connects + network.stats.refused + 1) % network.conditions.refuseEvery == 0) {
+            network.stats.refused++;
+            return 0;
+        }
+        network.stats.connects++;
+        _open = true;
+        return 1;
+    };
+    virtual size_t write(uint8_t c) {
+        return write(&c, 1);
+    };
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        if(!_open) {
+            return 0;
+        }
+        _request.reserve(_request.length() + size);
+        for(size_t i = 0; i < size; i++) {
+            _request += (char)buffer[i];
+        }
+        network().stats.bytesSent += size;
+        receiveRequests();
+        return size;
+    };
+    virtual int available() {
+        if(!_open) {
+            return 0;
+        }
+        size_t count = arrived() - _position;
+        size_t maxAvailable = network().conditions.maxAvailable;
+        return maxAvailable > 0 && count > maxAvailable ? maxAvailable : count;
+    };
+    virtual int read() {
+        if(available() == 0) {
+            return -1;
+        }
+        network().stats.bytesReceived++;
+        return (uint8_t)_response[_position++];
+    };
+    virtual int read(uint8_t* buffer, size_t size) {
+        size_t count = available();
+        if(count == 0) {
+            return -1;
+        }
+        if(count > size) {
+            count = size;
+        }
+        memcpy(buffer, _response.c_str() + _position, count);
+        _position += count;
+        network().stats.bytesReceived += count;
+        return count;
+    };
+    virtual int peek() {
+        return available() > 0 ? (uint8_t)_response[_position] : -1;
+    };
+    virtual void flush() {};
+    virtual void stop() {
+        disconnect();
+    };
+    virtual uint8_t connected() {
+        return _open;
+    };
+    virtual operator bool() {
+        return _open;
+    };
+};
+
+#endif
@@ -0,0 +1,79 @@
+/**************************************************************************/
+/*!
+    @file     SpscQueue.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_SPSC_QUEUE_
+#define _CONSTELLATION_SPSC_QUEUE_
+
+#include <stddef.h>
+#include <atomic>
+
+/*
+    Lock-free queue between one producer and one consumer (ex: two tasks or two cores).
+    Slots are filled and read in place : the producer reserves the next free slot, fills it and commits it,
+    the consumer reads the oldest slot with front() and gives it back with release().
+*/
+template<typename T, unsigned int CAPACITY>
+class SpscQueue
+{
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "The capacity of the queue must be a power of 2");
+
+  private:
+    T _slots[CAPACITY];
+    std::atomic<unsigned int> _head;    // next slot to read (consumer)
+    std::atomic<unsigned int> _tail;    // next slot to write (producer)
+
+  public:
+    SpscQueue() : _head(0), _tail(0) {}
+
+    // Producer : returns the next free slot, or NULL if the queue is full
+    T* reserve() {
+        unsigned int tail = _tail.load(std::memory_order_relaxed);
+        if(tail - _head.load(std::memory_order_acquire) >= CAPACITY) {
+            return NULL;
+        }
+        return &_slots[tail & (CAPACITY - 1)];
+    };
+    // Producer : publishes the reserved slot
+    void commit() {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    };
+
+    // Consumer : returns the oldest slot, or NULL if the queue is empty
+    T* front() {
+        unsigned int head = _head.load(std::memory_order_relaxed);
+        if(head == _tail.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+        return &_slots[head & (CAPACITY - 1)];
+    };
+    // Consumer : gives the slot returned by front() back to the producer
+    void release() {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    };
+
+    unsigned int size() {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    };
+};
+
+#endif
@@ -0,0 +1,177 @@
+/**************************************************************************/
+/*!
+    @file     StateObjectCache.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_STATEOBJECT_CACHE_
+#define _CONSTELLATION_STATEOBJECT_CACHE_
+
+#include <string.h>
+#include <ArduinoJson.h>
+#include "Hashing.h"
+
+/*
+    Local copy of the last received StateObjects, keyed by (sentinel, package, name), in a fixed arena of SIZE bytes.
+    Entries are packed one after the other : a small header, the key ("sentinel\0package\0name\0") then the JSON.
+    Each update gets a new version from a global counter, so a version number identifies one state of one StateObject.
+    When the arena is full, the least recently used entries are evicted.
+*/
+template<size_t SIZE>
+class StateObjectCache
+{
+  private:
+    typedef struct {
+        uint16_t size;              // whole entry, header included
+        uint16_t keyLength;
+        uint32_t keyHash;
+        uint32_t version;
+        uint32_t lastUsed;          // LRU clock
+        unsigned long receivedAt;   // millis() of the last update
+    } Entry;
+    alignas(Entry) uint8_t _arena[SIZE > 0 ? SIZE : 1];
+    size_t _used;
+    uint32_t _clock;
+    uint32_t _lastVersion;
+
+    static size_t align(size_t size) {
+        return (size + alignof(Entry) - 1) & ~(alignof(Entry) - 1);
+    };
+    uint8_t* bytes() {
+        return _arena;
+    };
+    static uint32_t hashKey(const char* sentinel, const char* package, const char* name) {
+        uint8_t separator = 0;
+        uint32_t hash = fnv1a(sentinel);
+        hash = fnv1a(&separator, 1, hash);
+        hash = fnv1a(package, hash);
+        hash = fnv1a(&separator, 1, hash);
+        return fnv1a(name, hash);
+    };
+    static const char* key(Entry* entry) {
+        return (const char*)(entry + 1);
+    };
+    Entry* find(const char* sentinel, const char* package, const char* name) {
+        uint32_t keyHash = hashKey(sentinel, package, name);
+        for(size_t offset = 0; offset < _used; offset += ((Entry*)(bytes() + offset))->size) {
+            Entry* entry = (Entry*)(bytes() + offset);
+            if(entry->keyHash != keyHash) {
+                continue;
+            }
+            const char* k = key(entry);
+            if(strcmp(k, sentinel) == 0 && strcmp(k += strlen(k) + 1, package) == 0 && strcmp(k + strlen(k) + 1, name) == 0) {
+                entry->lastUsed = ++_clock;
+                return entry;
+            }
+        }
+        return NULL;
+    };
+    void remove(Entry* entry) {
+        size_t offset = (uint8_t*)entry - bytes();
+        size_t size = entry->size;
+        memmove(bytes() + offset, bytes() + offset + size, _used - offset - size);
+        _used -= size;
+    };
+    void evictLeastRecentlyUsed() {
+        Entry* oldest = NULL;
+        for(size_t offset = 0; offset < _used; offset += ((Entry*)(bytes() + offset))->size) {
+            Entry* entry = (Entry*)(bytes() + offset);
+            if(oldest == NULL || (int32_t)(entry->lastUsed - oldest->lastUsed) < 0) {
+                oldest = entry;
+            }
+        }
+        remove(oldest);
+    };
+
+  public:
+    StateObjectCache() : _used(0), _clock(0), _lastVersion(0) {}
+
+    static bool enabled() {
+        return SIZE > 0;
+    };
+
+    // Stores the new value of a StateObject. Returns false if it's larger than the whole cache.
+    bool update(const char* sentinel, const char* package, const char* name, JsonObject& stateObject) {
+        Entry* entry = find(sentinel, package, name);
+        if(entry != NULL) {
+            remove(entry);
+        }
+        size_t keyLength = strlen(sentinel) + strlen(package) + strlen(name) + 3;
+        size_t jsonLength = stateObject.measureLength();
+        size_t size = align(sizeof(Entry) + keyLength + jsonLength + 1);
+        if(size > SIZE || size > 0xFFFF) {
+            return false;
+        }
+        while(SIZE - _used < size) {
+            evictLeastRecentlyUsed();
+        }
+        entry = (Entry*)(bytes() + _used);
+        entry->size = size;
+        entry->keyLength = keyLength;
+        entry->keyHash = hashKey(sentinel, package, name);
+        entry->version = ++_lastVersion;
+        entry->lastUsed = ++_clock;
+        entry->receivedAt = millis();
+        char* k = (char*)(entry + 1);
+        strcpy(k, sentinel);
+        strcpy(k += strlen(sentinel) + 1, package);
+        strcpy(k += strlen(package) + 1, name);
+        stateObject.printTo((char*)(entry + 1) + keyLength, jsonLength + 1);
+        _used += size;
+        return true;
+    };
+
+    // JSON of the cached StateObject (valid until the next update), or NULL
+    const char* get(const char* sentinel, const char* package, const char* name, uint32_t* version = NULL, unsigned long* receivedAt = NULL) {
+        Entry* entry = find(sentinel, package, name);
+        if(entry == NULL) {
+            return NULL;
+        }
+        if(version != NULL) {
+            *version = entry->version;
+        }
+        if(receivedAt != NULL) {
+            *receivedAt = entry->receivedAt;
+        }
+        return key(entry) + entry->keyLength;
+    };
+
+    // Version of the cached StateObject, 0 if it's not in the cache
+    uint32_t version(const char* sentinel, const char* package, const char* name) {
+        Entry* entry = find(sentinel, package, name);
+        return entry != NULL ? entry->version : 0;
+    };
+
+    int count() {
+        int count = 0;
+        for(size_t offset = 0; offset < _used; offset += ((Entry*)(bytes() + offset))->size) {
+            count++;
+        }
+        return count;
+    };
+    size_t used() {
+        return _used;
+    };
+    void clear() {
+        _used = 0;
+    };
+};
+
+#endif
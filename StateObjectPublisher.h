@@ -0,0 +1,73 @@
+/**************************************************************************/
+/*!
+    @file     StateObjectPublisher.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_STATEOBJECT_PUBLISHER_
+#define _CONSTELLATION_STATEOBJECT_PUBLISHER_
+
+#include <Print.h>
+#include "PackageDescriptor.h"
+
+/*
+    Data accumulated between two pushes and published as one StateObject (see Constellation::publishStateObject) :
+    the subclass prints its value as JSON and describes it with a StateObject type, declared in the package descriptor.
+*/
+class StateObjectPublisher
+{
+  public:
+    // The StateObject type of the value, and its properties
+    virtual const char* typeName() = 0;
+    virtual void describe(TypeDescriptor& type) = 0;
+    // False when there is nothing to push (ex: no sample since the last push)
+    virtual bool hasValue() = 0;
+    // Prints the value as a JSON object and returns its length. 'now' is the millis() of the push : the same value
+    // is printed twice (to measure it, then to send it).
+    virtual size_t printValue(Print& out, unsigned long now) = 0;
+    // The value printed last has been pushed
+    virtual void pushed() = 0;
+
+    // The value in 'buffer', null-terminated (truncated to size - 1 characters)
+    size_t printValue(char* buffer, size_t size, unsigned long now) {
+        class ArrayPrint : public Print {
+          public:
+            char* buffer;
+            size_t size;
+            size_t length;
+            using Print::write;
+            virtual size_t write(uint8_t c) {
+                if(length + 1 >= size) {
+                    return 0;
+                }
+                buffer[length++] = c;
+                return 1;
+            };
+        } out;
+        out.buffer = buffer;
+        out.size = size;
+        out.length = 0;
+        printValue(out, now);
+        buffer[out.length] = '\0';
+        return out.length;
+    };
+};
+
+#endif
@@ -0,0 +1,128 @@
+/**************************************************************************/
+/*!
+    @file     StaticContainers.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_STATIC_CONTAINERS_
+#define _CONSTELLATION_STATIC_CONTAINERS_
+
+#include <stddef.h>
+#include <string.h>
+#include <Print.h>
+
+/*
+    Fixed-capacity list with the same API as LinkedList (add, get, remove, size, clear).
+    Items are stored inline : no heap allocation, add() returns false when the list is full.
+*/
+template<typename T, int CAPACITY>
+class StaticList
+{
+  private:
+    T _items[CAPACITY];
+    int _size;
+
+  public:
+    StaticList() : _size(0) {}
+
+    int size() {
+        return _size;
+    };
+    bool add(T item) {
+        if(_size >= CAPACITY) {
+            return false;
+        }
+        _items[_size++] = item;
+        return true;
+    };
+    T& get(int index) {
+        return _items[index];
+    };
+    T remove(int index) {
+        T item = _items[index];
+        for(int i = index; i + 1 < _size; i++) {
+            _items[i] = _items[i + 1];
+        }
+        _size--;
+        return item;
+    };
+    void clear() {
+        _size = 0;
+    };
+};
+
+/*
+    Fixed-capacity string with the subset of the String API used to read the responses.
+    Characters that don't fit are dropped (concat returns false). It's also a Print.
+*/
+template<size_t CAPACITY>
+class FixedString : public Print
+{
+  private:
+    char _buffer[CAPACITY];
+    size_t _length;
+
+  public:
+    FixedString() : _length(0) {
+        _buffer[0] = '\0';
+    }
+
+    FixedString& operator=(const char* value) {
+        _length = 0;
+        _buffer[0] = '\0';
+        write((const uint8_t*)value, strlen(value));
+        return *this;
+    };
+
+    using Print::write;
+    virtual size_t write(uint8_t c) {
+        return concat((char)c) ? 1 : 0;
+    };
+    virtual size_t write(const uint8_t* data, size_t size) {
+        if(_length + size >= CAPACITY) {
+            size = CAPACITY - 1 - _length;
+        }
+        memcpy(_buffer + _length, data, size);
+        _length += size;
+        _buffer[_length] = '\0';
+        return size;
+    };
+
+    bool concat(char c) {
+        if(_length + 1 >= CAPACITY) {
+            return false;
+        }
+        _buffer[_length++] = c;
+        _buffer[_length] = '\0';
+        return true;
+    };
+    unsigned int length() const {
+        return _length;
+    };
+    const char* c_str() const {
+        return _buffer;
+    };
+    // Mutable access for in-place (zero-copy) parsing
+    char* begin() {
+        return _buffer;
+    };
+};
+
+#endif
@@ -0,0 +1,238 @@
+/**************************************************************************/
+/*!
+    @file     TaskScheduler.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_TASK_SCHEDULER_
+#define _CONSTELLATION_TASK_SCHEDULER_
+
+#include <stdint.h>
+#include <string.h>
+
+#define TASK_LATENESS_BUCKETS 16
+
+/*
+    Allocation-free cooperative scheduler : periodic tasks are kept in a min-heap ordered by deadline.
+    Each call to run() executes at most 'maxTasks' due tasks, so the work done per tick is bounded.
+    Tasks flagged 'duringIO' don't use the network and can also run while the library waits for a response.
+*/
+template<int CAPACITY>
+class TaskScheduler
+{
+  private:
+    typedef struct {
+        void (*callback)();
+        void (*callbackWithArg)(void*);
+        void* arg;
+        unsigned long interval;
+        unsigned long deadline;
+        unsigned long maxLateness;
+        bool enabled;
+        bool duringIO;
+    } Task;
+    Task _tasks[CAPACITY];
+    int _size;
+    uint8_t _heap[CAPACITY];    // task ids, the next deadline first
+    int _heapSize;
+    uint32_t _lateness[TASK_LATENESS_BUCKETS]; // log2 histogram of the lateness (ms)
+
+    bool before(uint8_t a, uint8_t b) {
+        return (long)(_tasks[a].deadline - _tasks[b].deadline) < 0;
+    };
+    void siftUp(int index) {
+        while(index > 0) {
+            int parent = (index - 1) / 2;
+            if(!before(_heap[index], _heap[parent])) {
+                break;
+            }
+            uint8_t id = _heap[index];
+            _heap[index] = _heap[parent];
+            _heap[parent] = id;
+            index = parent;
+        }
+    };
+    void siftDown(int index) {
+        while(true) {
+            int smallest = index;
+            int left = 2 * index + 1;
+            int right = left + 1;
+            if(left < _heapSize && before(_heap[left], _heap[smallest])) {
+                smallest = left;
+            }
+            if(right < _heapSize && before(_heap[right], _heap[smallest])) {
+                smallest = right;
+            }
+            if(smallest == index) {
+                break;
+            }
+            uint8_t id = _heap[index];
+            _heap[index] = _heap[smallest];
+            _heap[smallest] = id;
+            index = smallest;
+        }
+    };
+    void push(uint8_t id) {
+        _heap[_heapSize] = id;
+        siftUp(_heapSize++);
+    };
+    uint8_t pop() {
+        uint8_t id = _heap[0];
+        _heap[0] = _heap[--_heapSize];
+        siftDown(0);
+        return id;
+    };
+    void unschedule(uint8_t id) {
+        for(int i = 0; i < _heapSize; i++) {
+            if(_heap[i] == id) {
+                _heap[i] = _heap[--_heapSize];
+                if(i < _heapSize) {
+                    siftDown(i);
+                    siftUp(i);
+                }
+                return;
+            }
+        }
+    };
+    int add(void (*callback)(), void (*callbackWithArg)(void*), void* arg, unsigned long interval, bool duringIO) {
+        if(_size >= CAPACITY) {
+            return -1;
+        }
+        Task& task = _tasks[_size];
+        task.callback = callback;
+        task.callbackWithArg = callbackWithArg;
+        task.arg = arg;
+        task.interval = interval;
+        task.deadline = millis() + interval;
+        task.maxLateness = 0;
+        task.enabled = true;
+        task.duringIO = duringIO;
+        push(_size);
+        return _size++;
+    };
+
+  public:
+    TaskScheduler() : _size(0), _heapSize(0) {
+        memset(_lateness, 0, sizeof(_lateness));
+    }
+
+    int add(void (*callback)(), unsigned long interval, bool duringIO = false) {
+        return add(callback, NULL, NULL, interval, duringIO);
+    };
+    int add(void (*callback)(void*), void* arg, unsigned long interval, bool duringIO = false) {
+        return add(NULL, callback, arg, interval, duringIO);
+    };
+
+    bool setInterval(int id, unsigned long interval) {
+        if(id < 0 || id >= _size) {
+            return false;
+        }
+        _tasks[id].interval = interval;
+        if(_tasks[id].enabled) {
+            unschedule(id);
+            _tasks[id].deadline = millis() + interval;
+            push(id);
+        }
+        return true;
+    };
+
+    bool enable(int id, bool enabled = true) {
+        if(id < 0 || id >= _size) {
+            return false;
+        }
+        if(enabled && !_tasks[id].enabled) {
+            _tasks[id].deadline = millis() + _tasks[id].interval;
+            push(id);
+        }
+        else if(!enabled && _tasks[id].enabled) {
+            unschedule(id);
+        }
+        _tasks[id].enabled = enabled;
+        return true;
+    };
+
+    // Run at most 'maxTasks' due tasks (only the 'duringIO' tasks if 'inIO'). Returns the number of tasks run.
+    int run(int maxTasks, bool inIO = false) {
+        uint8_t skipped[CAPACITY];
+        int skippedCount = 0;
+        int count = 0;
+        unsigned long now = millis();
+        while(_heapSize > 0 && count < maxTasks && (long)(now - _tasks[_heap[0]].deadline) >= 0) {
+            uint8_t id = pop();
+            Task& task = _tasks[id];
+            if(inIO && !task.duringIO) {
+                skipped[skippedCount++] = id;
+                continue;
+            }
+            // Lateness statistics
+            unsigned long lateness = now - task.deadline;
+            if(lateness > task.maxLateness) {
+                task.maxLateness = lateness;
+            }
+            uint8_t bucket = 0;
+            while(lateness > 0 && bucket < TASK_LATENESS_BUCKETS - 1) {
+                lateness >>= 1;
+                bucket++;
+            }
+            _lateness[bucket]++;
+            // Next deadline : keep the phase, unless the task is late by more than one period
+            task.deadline += task.interval;
+            if((long)(now - task.deadline) >= 0) {
+                task.deadline = now + task.interval;
+            }
+            push(id);
+            count++;
+            if(task.callback) {
+                task.callback();
+            }
+            else {
+                task.callbackWithArg(task.arg);
+            }
+            now = millis();
+        }
+        while(skippedCount > 0) {
+            push(skipped[--skippedCount]);
+        }
+        return count;
+    };
+
+    unsigned long getMaxLateness(int id) {
+        return (id >= 0 && id < _size) ? _tasks[id].maxLateness : 0;
+    };
+
+    // Upper bound of the given percentile of the tasks lateness (ms), from a log2 histogram
+    unsigned long getLatenessPercentile(uint8_t percentile) {
+        uint32_t total = 0;
+        for(int i = 0; i < TASK_LATENESS_BUCKETS; i++) {
+            total += _lateness[i];
+        }
+        uint32_t threshold = (uint32_t)(((uint64_t)total * percentile + 99) / 100);
+        uint32_t count = 0;
+        for(int i = 0; i < TASK_LATENESS_BUCKETS; i++) {
+            count += _lateness[i];
+            if(count >= threshold && count > 0) {
+                return i == 0 ? 0 : (1UL << i) - 1;
+            }
+        }
+        return 0;
+    };
+};
+
+#endif
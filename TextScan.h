@@ -0,0 +1,164 @@
+/**************************************************************************/
+/*!
+    @file     TextScan.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_TEXT_SCAN_
+#define _CONSTELLATION_TEXT_SCAN_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+    Scanning kernels of the HTTP layer, several bytes per step :
+    - SSE2 (x86) or NEON (AArch64) on the Linux gateways, 16 bytes at a time,
+    - 32-bit words elsewhere (SWAR : "SIMD within a register") for the newlines, except on AVR where the byte loop is the fastest.
+      The unreserved characters take 6 range tests per word : the 16-byte bitmap below is faster without vector units.
+    The vector loads are aligned : they never cross a page, so reading past the end of the text (within the block) is safe.
+    Define CONSTELLATION_SCAN_PORTABLE to use the MCU kernels on any target.
+    Every kernel available on the target can be called directly (see the TextScan benchmark), unreservedSpan & findNewline
+    pick the fastest one.
+*/
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SCAN_NEON
+#endif
+#if defined(CONSTELLATION_SCAN_PORTABLE) || !defined(ARDUINO_ARCH_AVR)
+#define SCAN_WORDS
+#endif
+
+// URL unreserved characters (RFC 3986 : ALPHA / DIGIT / "-" / "." / "_" / "~", and "*"), one bit per ASCII code
+inline bool isUnreserved(uint8_t c) {
+    static const uint8_t unreserved[16] = { 0, 0, 0, 0, 0, 0x64, 0xFF, 0x03, 0xFE, 0xFF, 0xFF, 0x87, 0xFE, 0xFF, 0xFF, 0x47 };
+    return c < 128 && (unreserved[c >> 3] >> (c & 7)) & 1;
+}
+
+// Length of the run of unreserved characters at the start of 'text', byte per byte
+inline size_t unreservedSpanBytes(const char* text) {
+    const uint8_t* p = (const uint8_t*)text;
+    while(isUnreserved(*p)) {
+        p++;
+    }
+    return p - (const uint8_t*)text;
+}
+
+#if defined(SCAN_SSE2) || defined(SCAN_NEON)
+// ... 16 bytes at a time
+inline size_t unreservedSpanVector(const char* text) {
+    const uint8_t* p = (const uint8_t*)text;
+    while(((uintptr_t)p & 15) != 0) {
+        if(!isUnreserved(*p)) {
+            return p - (const uint8_t*)text;
+        }
+        p++;
+    }
+    // The '\0' is reserved : the loop ends in the block of the terminator at the latest
+    while(true) {
+#if defined(SCAN_SSE2)
+        // Signed compares : the bytes >= 0x80 are negative, out of every range
+        __m128i v = _mm_load_si128((const __m128i*)p);
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i r = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1))));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('-' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('.' + 1))));
+        r = _mm_or_si128(r, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~'))));
+        r = _mm_or_si128(r, _mm_cmpeq_epi8(v, _mm_set1_epi8('*')));
+        uint32_t reserved = ~(uint32_t)_mm_movemask_epi8(r) & 0xFFFF;
+        if(reserved != 0) {
+            return p - (const uint8_t*)text + __builtin_ctz(reserved);
+        }
+#elif defined(SCAN_NEON)
+        uint8x16_t v = vld1q_u8(p);
+        uint8x16_t lower = vorrq_u8(v, vdupq_n_u8(0x20));
+        uint8x16_t r = vandq_u8(vcgeq_u8(lower, vdupq_n_u8('a')), vcleq_u8(lower, vdupq_n_u8('z')));
+        r = vorrq_u8(r, vandq_u8(vcgeq_u8(v, vdupq_n_u8('0')), vcleq_u8(v, vdupq_n_u8('9'))));
+        r = vorrq_u8(r, vandq_u8(vcgeq_u8(v, vdupq_n_u8('-')), vcleq_u8(v, vdupq_n_u8('.'))));
+        r = vorrq_u8(r, vorrq_u8(vceqq_u8(v, vdupq_n_u8('_')), vceqq_u8(v, vdupq_n_u8('~'))));
+        r = vorrq_u8(r, vceqq_u8(v, vdupq_n_u8('*')));
+        if(vminvq_u8(r) != 0xFF) {
+            // End of the run in this block, byte per byte
+            return p - (const uint8_t*)text + unreservedSpanBytes((const char*)p);
+        }
+#endif
+        p += 16;
+    }
+}
+#endif
+
+inline size_t unreservedSpan(const char* text) {
+#if (defined(SCAN_SSE2) || defined(SCAN_NEON)) && !defined(CONSTELLATION_SCAN_PORTABLE)
+    return unreservedSpanVector(text);
+#else
+    return unreservedSpanBytes(text);
+#endif
+}
+
+// First '\n' of data[0..size) or NULL, byte per byte
+inline const uint8_t* findNewlineBytes(const uint8_t* data, size_t size) {
+    for(const uint8_t* end = data + size; data < end; data++) {
+        if(*data == '\n') {
+            return data;
+        }
+    }
+    return NULL;
+}
+
+#ifdef SCAN_WORDS
+#define SCAN_ONES ((uint32_t)0x01010101)
+
+// ... 4 bytes at a time
+inline const uint8_t* findNewlineWords(const uint8_t* data, size_t size) {
+    const uint8_t* end = data + size;
+    while(data < end && ((uintptr_t)data & (sizeof(uint32_t) - 1)) != 0) {
+        if(*data == '\n') {
+            return data;
+        }
+        data++;
+    }
+    for(; end - data >= (ptrdiff_t)sizeof(uint32_t); data += sizeof(uint32_t)) {
+        uint32_t x;
+        memcpy(&x, data, sizeof(x));
+        x ^= SCAN_ONES * '\n';
+        // A zero byte (a '\n') sets its high bit
+        if(((x - SCAN_ONES) & ~x & (SCAN_ONES * 128)) != 0) {
+            break;
+        }
+    }
+    return findNewlineBytes(data, end - data);
+}
+#endif
+
+inline const uint8_t* findNewline(const uint8_t* data, size_t size) {
+#if defined(__linux__) && !defined(CONSTELLATION_SCAN_PORTABLE)
+    // The C library of the gateways (glibc, musl) already has a SSE2/NEON memchr
+    return (const uint8_t*)memchr(data, '\n', size);
+#elif defined(SCAN_WORDS)
+    return findNewlineWords(data, size);
+#else
+    return findNewlineBytes(data, size);
+#endif
+}
+
+#endif
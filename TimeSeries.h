@@ -0,0 +1,244 @@
+/**************************************************************************/
+/*!
+    @file     TimeSeries.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_TIME_SERIES_
+#define _CONSTELLATION_TIME_SERIES_
+
+#include <Arduino.h>
+#include <math.h>
+#include "StateObjectPublisher.h"
+
+#define TIMESERIES_TYPE "TimeSeries"
+
+/*
+    Samples (timestamp, value) recorded in a ring of SIZE bytes and pushed together as one StateObject :
+
+        TimeSeries<512> temperature(0.01);          // values rounded to 0.01
+        constellation.publishStateObject("Temperature", temperature, 5000);
+        temperature.add(readTemperature());         // at any rate, ex: from a task
+
+    Each sample is stored as the difference with the previous one : the ms elapsed as a varint (LEB128) and the value,
+    quantized to the resolution, as a zigzag varint. A steady signal sampled at 100 Hz takes 2 or 3 bytes per sample.
+    When the ring is full, the oldest samples are overwritten (counted in "Dropped").
+    The value pushed is { "Start": ms between the first sample and the push, "Offsets": [ms from the first sample],
+    "Values": [...], "Dropped": samples overwritten }, the time of a sample being the LastUpdate of the StateObject - Start + offset.
+    It's printed straight into the request when pushed : about 10 bytes per sample.
+*/
+template<size_t SIZE>
+class TimeSeries : public StateObjectPublisher
+{
+  private:
+    static const size_t MaxRecordSize = 10;     // 2 varints of 32 bits
+    uint8_t _buffer[SIZE];
+    size_t _head;                   // first byte of the oldest record
+    size_t _size;                   // bytes used
+    size_t _count;
+    float _resolution;
+    uint8_t _decimals;              // of the values printed
+    unsigned long _baseTime;        // sample before the oldest record (its deltas are relative to it)
+    int32_t _baseValue;
+    unsigned long _lastTime;        // newest sample
+    int32_t _lastValue;
+    uint32_t _first;                // sequence number of the oldest record
+    uint32_t _printed;              // sequence number after the last record printed
+    uint32_t _dropped;
+    uint32_t _droppedPrinted;
+    uint32_t _overwrittenPrinted;   // samples printed, then overwritten before pushed()
+
+    static size_t writeVarint(uint8_t* out, uint32_t value) {
+        size_t length = 0;
+        while(value >= 0x80) {
+            out[length++] = (uint8_t)value | 0x80;
+            value >>= 7;
+        }
+        out[length++] = (uint8_t)value;
+        return length;
+    };
+    uint32_t readVarint(size_t& position) {
+        uint32_t value = 0;
+        for(uint8_t shift = 0; ; shift += 7) {
+            uint8_t b = _buffer[position];
+            position = (position + 1) % SIZE;
+            value |= (uint32_t)(b & 0x7F) << shift;
+            if((b & 0x80) == 0) {
+                return value;
+            }
+        }
+    };
+    // Decodes the record at 'position' from the sample (time, value) before it, returns its size
+    size_t readRecord(size_t position, unsigned long& time, int32_t& value) {
+        size_t start = position;
+        time += readVarint(position);
+        uint32_t zigzag = readVarint(position);
+        value = (int32_t)((uint32_t)value + ((zigzag >> 1) ^ (0 - (zigzag & 1))));
+        return (position + SIZE - start) % SIZE;
+    };
+    // The offsets (ms from 'first') or the values of the samples, separated by commas
+    size_t printSamples(Print& out, unsigned long first, bool values) {
+        unsigned long time = _baseTime;
+        int32_t value = _baseValue;
+        size_t position = _head;
+        size_t length = 0;
+        for(size_t i = 0; i < _count; i++) {
+            position = (position + readRecord(position, time, value)) % SIZE;
+            if(i > 0) {
+                length += out.print(',');
+            }
+            length += values ? out.print(value * (double)_resolution, _decimals) : out.print(time - first);
+        }
+        return length;
+    };
+    void removeOldest() {
+        size_t length = readRecord(_head, _baseTime, _baseValue);
+        _head = (_head + length) % SIZE;
+        _size -= length;
+        _count--;
+        _first++;
+    };
+
+  public:
+    TimeSeries(float resolution = 0.01) : _head(0), _size(0), _count(0), _resolution(resolution > 0 ? resolution : 1), _first(0), _printed(0), _dropped(0), _droppedPrinted(0), _overwrittenPrinted(0) {
+        _decimals = 0;
+        for(float step = _resolution; step < 0.999 && _decimals < 6; step *= 10) {
+            _decimals++;
+        }
+    }
+
+    // Records 'value' at 'timestamp' (millis(), not before the previous sample). Returns false if the sample can't be stored.
+    bool add(float value) {
+        return add(millis(), value);
+    };
+    bool add(unsigned long timestamp, float value) {
+        float quantized = roundf(value / _resolution);
+        if(!(quantized > -2147483520.0f && quantized < 2147483520.0f)) {
+            return false;
+        }
+        int32_t q = (int32_t)quantized;
+        if(_count == 0) {
+            _baseTime = _lastTime = timestamp;
+            _baseValue = _lastValue = q;
+        }
+        uint8_t record[MaxRecordSize];
+        int32_t delta = (int32_t)((uint32_t)q - (uint32_t)_lastValue);
+        size_t length = writeVarint(record, timestamp - _lastTime);
+        length += writeVarint(record + length, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        if(length > SIZE) {
+            return false;
+        }
+        while(SIZE - _size < length) {
+            // A sample printed is sent if the push succeeds (see pushed)
+            if((int32_t)(_printed - _first) > 0) {
+                _overwrittenPrinted++;
+            }
+            else {
+                _dropped++;
+            }
+            removeOldest();
+        }
+        size_t tail = (_head + _size) % SIZE;
+        for(size_t i = 0; i < length; i++) {
+            _buffer[(tail + i) % SIZE] = record[i];
+        }
+        _size += length;
+        _count++;
+        _lastTime = timestamp;
+        _lastValue = q;
+        return true;
+    };
+
+    size_t count() {
+        return _count;
+    };
+    // Bytes taken by the samples in the ring
+    size_t bytes() {
+        return _size;
+    };
+    // Samples overwritten since the last push
+    uint32_t dropped() {
+        return _dropped;
+    };
+    void clear() {
+        _first += _count;
+        _head = _size = _count = 0;
+        _dropped = _droppedPrinted = _overwrittenPrinted = 0;
+    };
+
+    // Calls 'callback' for each sample, the oldest first
+    void forEach(void (*callback)(unsigned long timestamp, float value, void* context), void* context = NULL) {
+        unsigned long time = _baseTime;
+        int32_t value = _baseValue;
+        size_t position = _head;
+        for(size_t i = 0; i < _count; i++) {
+            position = (position + readRecord(position, time, value)) % SIZE;
+            callback(time, value * _resolution, context);
+        }
+    };
+
+    using StateObjectPublisher::printValue;
+    const char* typeName() {
+        return TIMESERIES_TYPE;
+    };
+    void describe(TypeDescriptor& type) {
+        type.setDescription("Samples pushed together : the time of a sample is LastUpdate - Start + its offset")
+            .addProperty<unsigned long>("Start", "ms between the first sample and the push")
+            .addProperty("Offsets", "System.Int32[]", "ms between each sample and the first one")
+            .addProperty("Values", "System.Double[]")
+            .addProperty<unsigned long>("Dropped", "Samples overwritten since the previous push (buffer full)");
+    };
+    bool hasValue() {
+        return _count > 0;
+    };
+    size_t printValue(Print& out, unsigned long now) {
+        // The previous push has failed : the samples overwritten since are lost
+        _dropped += _overwrittenPrinted;
+        _overwrittenPrinted = 0;
+        unsigned long first = _baseTime;
+        int32_t value = 0;
+        if(_count > 0) {
+            readRecord(_head, first, value);
+        }
+        size_t length = out.print("{\"Start\":");
+        length += out.print(_count > 0 ? now - first : 0);
+        length += out.print(",\"Offsets\":[");
+        length += printSamples(out, first, false);
+        length += out.print("],\"Values\":[");
+        length += printSamples(out, first, true);
+        length += out.print("],\"Dropped\":");
+        length += out.print(_dropped);
+        length += out.print('}');
+        _printed = _first + _count;
+        _droppedPrinted = _dropped;
+        return length;
+    };
+    // Removes the samples pushed (the ones added meanwhile are kept for the next push)
+    void pushed() {
+        while(_count > 0 && (int32_t)(_printed - _first) > 0) {
+            removeOldest();
+        }
+        _dropped -= _droppedPrinted;
+        _droppedPrinted = 0;
+        _overwrittenPrinted = 0;
+    };
+};
+
+#endif
@@ -0,0 +1,62 @@
+/**************************************************************************/
+/*!
+    @file     TlsSession.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_TLS_SESSION_
+#define _CONSTELLATION_TLS_SESSION_
+
+/*
+    TLS session resumption : when the network class has a 'setSession(TSession*)' method (ex: BearSSL::WiFiClientSecure
+    on ESP8266), each connection keeps its TLS session so that a reconnection resumes it instead of a full handshake.
+    The network class is inspected when Constellation is instantiated, whatever the include order.
+    For another TLS client, specialize TlsSession<YourClientClass> with the same members.
+*/
+
+template<typename T>
+struct TlsSessionCheck {
+    typedef void type;
+};
+template<typename TMethod>
+struct TlsSessionArgument;
+template<typename TClient, typename TSession>
+struct TlsSessionArgument<void (TClient::*)(TSession*)> {
+    typedef TSession type;
+};
+
+// Network class without TLS session support
+template<typename TNetworkClass, typename = void>
+struct TlsSession {
+    static const bool Supported = false;
+    void attach(TNetworkClass&) { };
+};
+
+// Network class with a 'setSession' method
+template<typename TNetworkClass>
+struct TlsSession<TNetworkClass, typename TlsSessionCheck<decltype(&TNetworkClass::setSession)>::type> {
+    static const bool Supported = true;
+    typename TlsSessionArgument<decltype(&TNetworkClass::setSession)>::type session;
+    void attach(TNetworkClass& client) {
+        client.setSession(&session);
+    };
+};
+
+#endif
@@ -0,0 +1,121 @@
+/**************************************************************************/
+/*!
+    @file     TraceRing.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_TRACE_RING_
+#define _CONSTELLATION_TRACE_RING_
+
+#include <stdint.h>
+#include <Print.h>
+
+#if defined(ESP32) || defined(__linux__)
+#include <atomic>
+typedef std::atomic<uint32_t> TraceIndex;
+#else
+typedef volatile uint32_t TraceIndex;
+#endif
+
+// Event ids of the trace (keep in sync with extras/trace_decode.py)
+enum TraceEvent : uint16_t {
+    TraceConnect = 1,           // arg: connection (0 = requests, 1 = messages, 2 = StateObjects), value: connect time (ms)
+    TraceConnectFailed = 2,     // arg: connection
+    TraceStaleReconnect = 3,
+    TraceRequest = 4,           // arg: 'G'et or 'P'ost, value: hash of the method ('Q'ueued request : its length)
+    TraceRetry = 5,             // value: hash of the method
+    TraceResponseTimeout = 6,
+    TraceResponseHeader = 7,    // arg: status code, value: header lines
+    TraceResponseBody = 8,      // arg: flags (1 = truncated, 2 = MessagePack, 4 = compressed), value: body bytes
+    TraceDecodeError = 9,
+    TraceMessage = 10,          // value: hash of the message key
+    TraceStateObject = 11,      // value: hash of the StateObject name
+    TraceItemDropped = 12,      // arg: 1 for a StateObject, value: dropped items
+    TraceDuplicate = 13,        // arg: 1 for a StateObject, value: fingerprint of the message or hash of the StateObject name
+    TraceUser = 0x8000          // first id free for the application
+};
+
+/*
+    Binary trace kept in RAM : each event is a timestamp (us), an id & two small arguments, recorded without any formatting
+    and overwriting the oldest ones. dump() prints the ring in hexadecimal, to decode off-line with extras/trace_decode.py.
+*/
+template<int CAPACITY>
+class TraceRing
+{
+  private:
+    typedef struct {
+        uint32_t time;
+        uint16_t event;
+        uint16_t arg;
+        uint32_t value;
+    } Record;
+    static const uint32_t Size = CAPACITY > 0 ? CAPACITY : 1;
+    Record _records[Size];
+    TraceIndex _head;               // events recorded since the start
+
+    static void printHex(Print& out, uint32_t value, uint8_t digits) {
+        static const char hex[] = "0123456789ABCDEF";
+        while(digits-- > 0) {
+            out.print(hex[(value >> (4 * digits)) & 15]);
+        }
+    };
+
+  public:
+    TraceRing() : _head(0) {}
+
+    static bool enabled() {
+        return CAPACITY > 0;
+    };
+
+    void record(uint16_t event, uint16_t arg = 0, uint32_t value = 0) {
+        if(CAPACITY > 0) {
+            Record& record = _records[(uint32_t)(_head++) % Size];
+            record.time = micros();
+            record.event = event;
+            record.arg = arg;
+            record.value = value;
+        }
+    };
+
+    // Prints the recorded events, the oldest first : a "CTR1 <capacity> <recorded>" line then one line of 24 hex digits per event
+    void dump(Print& out) {
+        uint32_t head = _head;
+        uint32_t count = head < (uint32_t)CAPACITY ? head : CAPACITY;
+        out.print("CTR1 ");
+        out.print(CAPACITY);
+        out.print(' ');
+        out.println(head);
+        for(uint32_t i = head - count; i != head; i++) {
+            const Record& record = _records[i % Size];
+            printHex(out, record.time, 8);
+            printHex(out, record.event, 4);
+            printHex(out, record.arg, 4);
+            printHex(out, record.value, 8);
+            out.println();
+        }
+        out.println("END");
+    };
+
+    void clear() {
+        _head = 0;
+    };
+};
+
+#endif
@@ -0,0 +1,261 @@
+/**************************************************************************/
+/*!
+    @file     TypedCallback.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_TYPED_CALLBACK_
+#define _CONSTELLATION_TYPED_CALLBACK_
+
+#include <string.h>
+#include <type_traits>
+#include <ArduinoJson.h>
+#include "BaseDefinitions.h"
+#include "PackageDescriptor.h"
+
+#define TYPED_CALLBACK_MAX_ARGS 8
+
+// Keeps a template parameter out of the deduction (the callback type is given by the explicit Args)
+template<typename T>
+struct Identity {
+    typedef T type;
+};
+
+// std::index_sequence is C++14
+template<size_t... I>
+struct IndexSequence {};
+template<size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+template<size_t... I>
+struct MakeIndexSequence<0, I...> {
+    typedef IndexSequence<I...> type;
+};
+
+template<typename... T>
+struct FirstArgument {
+    typedef void type;
+};
+template<typename T, typename... Rest>
+struct FirstArgument<T, Rest...> {
+    typedef typename std::decay<T>::type type;
+};
+
+// Check & conversion of a JSON value to a callback argument (bool & the types ArduinoJson converts itself)
+template<typename T, typename Enable = void>
+struct ArgumentBinder {
+    static bool matches(const JsonVariant& value) {
+        return value.is<T>();
+    };
+    static T convert(const JsonVariant& value) {
+        return value.as<T>();
+    };
+};
+template<typename T>
+struct ArgumentBinder<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static bool matches(const JsonVariant& value) {
+        return value.is<long>() || value.is<unsigned long>();
+    };
+    static T convert(const JsonVariant& value) {
+        return value.as<T>();
+    };
+};
+template<typename T>
+struct ArgumentBinder<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static bool matches(const JsonVariant& value) {
+        return value.is<double>() || value.is<long>();
+    };
+    static T convert(const JsonVariant& value) {
+        return value.as<T>();
+    };
+};
+template<>
+struct ArgumentBinder<const char*> {
+    static bool matches(const JsonVariant& value) {
+        return value.is<const char*>();
+    };
+    static const char* convert(const JsonVariant& value) {
+        return value.as<const char*>();
+    };
+};
+template<>
+struct ArgumentBinder<String> {
+    static bool matches(const JsonVariant& value) {
+        return value.is<const char*>();
+    };
+    static String convert(const JsonVariant& value) {
+        return value.as<String>();
+    };
+};
+template<>
+struct ArgumentBinder<JsonObject> {
+    static bool matches(const JsonVariant& value) {
+        return value.is<JsonObject&>();
+    };
+    static JsonObject& convert(const JsonVariant& value) {
+        return value.as<JsonObject&>();
+    };
+};
+template<>
+struct ArgumentBinder<JsonArray> {
+    static bool matches(const JsonVariant& value) {
+        return value.is<JsonArray&>();
+    };
+    static JsonArray& convert(const JsonVariant& value) {
+        return value.as<JsonArray&>();
+    };
+};
+template<>
+struct ArgumentBinder<JsonVariant> {
+    static bool matches(const JsonVariant&) {
+        return true;
+    };
+    static JsonVariant convert(const JsonVariant& value) {
+        return value;
+    };
+};
+
+/*
+    Binds the Data of a message to the arguments of a typed callback, in one pass :
+    an array is bound by position, an object by the parameter names of the descriptor, and a single argument takes the Data itself.
+    Each value is checked against its argument type, the missing optional parameters take their default value.
+*/
+template<typename... Args>
+class TypedCallback
+{
+    static_assert(sizeof...(Args) <= TYPED_CALLBACK_MAX_ARGS, "Too many arguments for a typed MessageCallback");
+
+  public:
+    typedef void (*Function)(Args...);
+    typedef void (*FunctionWithContext)(Args..., MessageContext);
+    static const size_t Count = sizeof...(Args);
+
+  private:
+    template<typename T>
+    using Binder = ArgumentBinder<typename std::decay<T>::type>;
+
+    template<size_t... I>
+    static bool matches(JsonVariant* values, IndexSequence<I...>) {
+        bool matches[] = { true, Binder<Args>::matches(values[I])... };
+        for(size_t i = 0; i <= Count; i++) {
+            if(!matches[i]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    template<size_t... I>
+    static void call(Function callback, JsonVariant* values, IndexSequence<I...>) {
+        callback(Binder<Args>::convert(values[I])...);
+    };
+    template<size_t... I>
+    static void call(FunctionWithContext callback, JsonVariant* values, MessageContext& ctx, IndexSequence<I...>) {
+        callback(Binder<Args>::convert(values[I])..., ctx);
+    };
+
+    static bool bind(JsonVariant& data, MessageCallbackDescriptor& descriptor, JsonVariant* values, bool* bound) {
+        typedef typename FirstArgument<Args...>::type First;
+        if(Count == 0) {
+            return true;
+        }
+        memset(bound, 0, Count);
+        // A single argument takes the Data itself, unless it's a simple value wrapped in an array or an object
+        bool isSimple = !std::is_same<First, JsonArray>::value && !std::is_same<First, JsonObject>::value && !std::is_same<First, JsonVariant>::value;
+        if(Count == 1 && !(isSimple && (data.is<JsonObject&>() || (data.is<JsonArray&>() && data.as<JsonArray&>().size() == 1)))) {
+            values[0] = data;
+            bound[0] = data.success();
+        }
+        else if(data.is<JsonArray&>()) {
+            size_t index = 0;
+            for(JsonVariant& value : data.as<JsonArray&>()) {
+                if(index >= Count) {
+                    return false; // more values than parameters
+                }
+                values[index] = value;
+                bound[index++] = true;
+            }
+        }
+        else if(data.is<JsonObject&>()) {
+            const char* names[Count > 0 ? Count : 1];
+            for(size_t i = 0; i < Count; i++) {
+                names[i] = (int)i < descriptor.getMemberCount() ? descriptor.getMemberInfo(i).name : NULL;
+            }
+            for(JsonPair& pair : data.as<JsonObject&>()) {
+                for(size_t i = 0; i < Count; i++) {
+                    if(names[i] != NULL && strcmp(pair.key, names[i]) == 0) {
+                        values[i] = pair.value;
+                        bound[i] = true;
+                        break;
+                    }
+                }
+            }
+        }
+        // Default values of the missing optional parameters
+        for(size_t i = 0; i < Count; i++) {
+            if(!bound[i]) {
+                if((int)i >= descriptor.getMemberCount() || !descriptor.getMemberInfo(i).isOptional) {
+                    return false;
+                }
+                values[i] = descriptor.getMemberInfo(i).defaultValue;
+            }
+        }
+        return matches(values, typename MakeIndexSequence<Count>::type());
+    };
+
+  public:
+    // Adds the parameters missing in the descriptor for Args (named arg0, arg1, ...).
+    // Returns false if the descriptor declares more parameters than Args, or a parameter of another simple type.
+    static bool describe(MessageCallbackDescriptor& descriptor) {
+        static const char* const names[TYPED_CALLBACK_MAX_ARGS] = { "arg0", "arg1", "arg2", "arg3", "arg4", "arg5", "arg6", "arg7" };
+        const char* types[] = { "", descriptor.template getTypename<typename std::decay<Args>::type>()... };
+        if(descriptor.getMemberCount() > (int)Count) {
+            return false;
+        }
+        for(size_t i = 0; i < Count; i++) {
+            if((int)i < descriptor.getMemberCount()) {
+                const char* type = descriptor.getMemberInfo(i).type;
+                if(strcmp(types[i + 1], "System.Object") != 0 && strcmp(type, types[i + 1]) != 0) {
+                    return false;
+                }
+            }
+            else {
+                descriptor.addParameter(names[i], types[i + 1]);
+            }
+        }
+        return true;
+    };
+
+    // Invokes the callback with the Data of a message : false if the Data doesn't match the arguments
+    static bool invoke(JsonVariant& data, MessageCallbackDescriptor& descriptor, void (*callback)(), MessageContext* ctx) {
+        JsonVariant values[Count > 0 ? Count : 1];
+        bool bound[Count > 0 ? Count : 1];
+        if(!bind(data, descriptor, values, bound)) {
+            return false;
+        }
+        if(ctx != NULL) {
+            call(reinterpret_cast<FunctionWithContext>(callback), values, *ctx, typename MakeIndexSequence<Count>::type());
+        }
+        else {
+            call(reinterpret_cast<Function>(callback), values, typename MakeIndexSequence<Count>::type());
+        }
+        return true;
+    };
+};
+
+#endif
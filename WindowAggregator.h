@@ -0,0 +1,358 @@
+/**************************************************************************/
+/*!
+    @file     WindowAggregator.h
+    @author   Sebastien Warin (http://sebastien.warin.fr)
+    @version  2.4.18186
+
+    @section LICENSE
+
+    Constellation License Agreement
+
+    Copyright (c) 2015-2018, Sebastien Warin
+    All rights reserved.
+
+    By receiving, opening the file package, and/or using Constellation 1.8("Software")
+    containing this software, you agree that this End User User License Agreement(EULA)
+    is a legally binding and valid contract and agree to be bound by it.
+    You agree to abide by the intellectual property laws and all of the terms and
+    conditions of this Agreement.
+    http://www.myconstellation.io/license.txt
+
+*/
+/**************************************************************************/
+
+#ifndef _CONSTELLATION_WINDOW_AGGREGATOR_
+#define _CONSTELLATION_WINDOW_AGGREGATOR_
+
+#include <Arduino.h>
+#include <math.h>
+#include "StateObjectPublisher.h"
+
+#define WINDOW_STATS_TYPE "WindowStats"
+
+// Count, mean & variance (Welford), min & max of a stream, in constant memory
+class RunningStats
+{
+  private:
+    uint32_t _count;
+    double _mean;
+    double _m2;                     // sum of the squared differences to the mean
+    float _min;
+    float _max;
+
+  public:
+    RunningStats() {
+        clear();
+    }
+
+    void add(float value) {
+        _count++;
+        double delta = value - _mean;
+        _mean += delta / _count;
+        _m2 += delta * (value - _mean);
+        if(_count == 1 || value < _min) {
+            _min = value;
+        }
+        if(_count == 1 || value > _max) {
+            _max = value;
+        }
+    };
+    // Adds the values of 'other' (Chan et al. : the variance of the union from both variances)
+    void merge(const RunningStats& other) {
+        if(other._count == 0) {
+            return;
+        }
+        if(_count == 0) {
+            *this = other;
+            return;
+        }
+        uint32_t count = _count + other._count;
+        double delta = other._mean - _mean;
+        _mean += delta * other._count / count;
+        _m2 += other._m2 + delta * delta * _count / count * other._count;
+        _min = other._min < _min ? other._min : _min;
+        _max = other._max > _max ? other._max : _max;
+        _count = count;
+    };
+    void clear() {
+        _count = 0;
+        _mean = _m2 = 0;
+        _min = _max = 0;
+    };
+
+    uint32_t count() const {
+        return _count;
+    };
+    float mean() const {
+        return _mean;
+    };
+    // Standard deviation of the values (population)
+    float stddev() const {
+        return _count > 0 ? sqrt(_m2 / _count) : 0;
+    };
+    float minimum() const {
+        return _min;
+    };
+    float maximum() const {
+        return _max;
+    };
+};
+
+/*
+    Streaming estimation of a quantile 'p' (0 to 1) with the P² algorithm (Jain & Chlamtac) : 5 markers follow the min, p/2, p,
+    (1 + p)/2 and the max, adjusted with a parabolic interpolation after each value. The count of values is given by the caller.
+*/
+class P2Quantile
+{
+  private:
+    float _heights[5];
+    uint32_t _positions[5];
+
+    float parabolic(int i, int d) {
+        float n = _positions[i], nPrevious = _positions[i - 1], nNext = _positions[i + 1];
+        return _heights[i] + d / (nNext - nPrevious) * ((n - nPrevious + d) * (_heights[i + 1] - _heights[i]) / (nNext - n)
+            + (nNext - n - d) * (_heights[i] - _heights[i - 1]) / (n - nPrevious));
+    };
+    float linear(int i, int d) {
+        return _heights[i] + d * (_heights[i + d] - _heights[i]) / ((float)_positions[i + d] - _positions[i]);
+    };
+
+  public:
+    // 'count' : values added before this one
+    void add(float value, float p, uint32_t count) {
+        if(count < 5) {
+            // The first values, sorted
+            int i = count;
+            for(; i > 0 && _heights[i - 1] > value; i--) {
+                _heights[i] = _heights[i - 1];
+            }
+            _heights[i] = value;
+            _positions[count] = count + 1;
+            return;
+        }
+        int k;
+        if(value < _heights[0]) {
+            _heights[0] = value;
+            k = 0;
+        }
+        else if(value >= _heights[4]) {
+            _heights[4] = value;
+            k = 3;
+        }
+        else {
+            for(k = 0; k < 3 && value >= _heights[k + 1]; k++);
+        }
+        for(int i = k + 1; i < 5; i++) {
+            _positions[i]++;
+        }
+        const float increments[5] = { 0, p / 2, p, (1 + p) / 2, 1 };
+        for(int i = 1; i < 4; i++) {
+            float d = 1 + count * increments[i] - _positions[i];
+            if((d >= 1 && _positions[i + 1] - _positions[i] > 1) || (d <= -1 && _positions[i] - _positions[i - 1] > 1)) {
+                int direction = d > 0 ? 1 : -1;
+                float height = parabolic(i, direction);
+                _heights[i] = _heights[i - 1] < height && height < _heights[i + 1] ? height : linear(i, direction);
+                _positions[i] += direction;
+            }
+        }
+    };
+    float estimate(float p, uint32_t count) {
+        if(count == 0) {
+            return 0;
+        }
+        if(count < 5) {
+            return _heights[(int)(p * (count - 1) + 0.5f)];
+        }
+        return _heights[2];
+    };
+};
+
+/*
+    Summary of a sensor over time windows, pushed once per window instead of every reading :
+
+        WindowAggregator<> temperature(60000);      // tumbling window of 1 min
+        temperature.addPercentile(50).addPercentile(95);
+        constellation.publishStateObject("Temperature", temperature, temperature.interval());
+        temperature.add(readTemperature());         // at any rate
+
+    With PANES > 1, the window slides : it's made of PANES panes of window / PANES ms, and a summary of the last PANES panes
+    is pushed at the end of each pane. The memory doesn't depend on the number of values : each pane keeps its running
+    statistics and a P² estimator per percentile (up to PERCENTILES). The panes are merged exactly for the count, min, max,
+    mean & standard deviation, the percentiles are the mean of the panes' estimates weighted by their counts.
+    The value pushed is { "Count", "Min", "Max", "Mean", "StdDev", "P50", ..., "Window": ms covered }. Give a different
+    type name to the aggregators with other percentiles : the type is declared by the first one published.
+*/
+template<int PANES = 1, int PERCENTILES = 2>
+class WindowAggregator : public StateObjectPublisher
+{
+  private:
+    typedef struct {
+        RunningStats stats;
+        P2Quantile quantiles[PERCENTILES > 0 ? PERCENTILES : 1];
+    } Pane;
+    Pane _panes[PANES + 1];         // the last PANES panes closed, then the open pane
+    int _newest;                    // newest closed pane
+    unsigned long _paneLength;
+    unsigned long _paneStart;       // millis() of the open pane
+    bool _started;
+    uint32_t _closed;               // panes closed so far
+    uint32_t _printed;              // ... when the summary was printed last
+    uint32_t _pushed;
+    float _percentiles[PERCENTILES > 0 ? PERCENTILES : 1];
+    char _names[PERCENTILES > 0 ? PERCENTILES : 1][5];     // "P95"
+    int _percentileCount;
+    const char* _typeName;
+    uint8_t _decimals;
+
+    Pane& openPane() {
+        return _panes[PANES];
+    };
+    // Closes the panes ended at 'now'
+    void advance(unsigned long now) {
+        if(!_started) {
+            _paneStart = now;
+            _started = true;
+            return;
+        }
+        for(int i = 0; now - _paneStart >= _paneLength; i++) {
+            if(i > PANES) {
+                // Idle for longer than the window : every pane is now empty
+                _paneStart = now - (now - _paneStart) % _paneLength;
+                break;
+            }
+            _newest = (_newest + 1) % PANES;
+            _panes[_newest] = openPane();
+            openPane().stats.clear();
+            _paneStart += _paneLength;
+            _closed++;
+        }
+    };
+    // The closed panes of the window
+    int windowPanes() {
+        return _closed < (uint32_t)PANES ? _closed : PANES;
+    };
+    RunningStats summary() {
+        RunningStats stats;
+        for(int i = 0; i < windowPanes(); i++) {
+            stats.merge(_panes[(_newest + PANES - i) % PANES].stats);
+        }
+        return stats;
+    };
+    size_t printNumber(Print& out, const char* name, float value) {
+        size_t length = out.print(",\"");
+        length += out.print(name);
+        length += out.print("\":");
+        return length + out.print(value, _decimals);
+    };
+
+  public:
+    // 'window' : length of the window in ms, 'decimals' : of the values pushed
+    WindowAggregator(unsigned long window, uint8_t decimals = 2, const char* typeName = WINDOW_STATS_TYPE)
+        : _newest(PANES - 1), _paneLength(window / PANES > 0 ? window / PANES : 1), _paneStart(0), _started(false), _closed(0), _printed(0), _pushed(0),
+          _percentileCount(0), _typeName(typeName), _decimals(decimals) {}
+
+    // Estimates this percentile (ex: 95) in each window
+    WindowAggregator& addPercentile(uint8_t percentile) {
+        if(_percentileCount < PERCENTILES && percentile <= 100) {
+            _percentiles[_percentileCount] = percentile / 100.0f;
+            snprintf(_names[_percentileCount], sizeof(_names[0]), "P%u", percentile);
+            _percentileCount++;
+        }
+        return *this;
+    };
+    // Interval of the summaries (ms) : the length of a pane
+    unsigned long interval() {
+        return _paneLength;
+    };
+
+    void add(float value) {
+        add(millis(), value);
+    };
+    void add(unsigned long timestamp, float value) {
+        if(value != value) {    // NaN
+            return;
+        }
+        advance(timestamp);
+        Pane& pane = openPane();
+        for(int i = 0; i < _percentileCount; i++) {
+            pane.quantiles[i].add(value, _percentiles[i], pane.stats.count());
+        }
+        pane.stats.add(value);
+    };
+
+    // Summary of the last window closed
+    uint32_t count() {
+        return summary().count();
+    };
+    float mean() {
+        return summary().mean();
+    };
+    float stddev() {
+        return summary().stddev();
+    };
+    float minimum() {
+        return summary().minimum();
+    };
+    float maximum() {
+        return summary().maximum();
+    };
+    // Percentile added at 'index' (see addPercentile)
+    float percentile(int index) {
+        if(index < 0 || index >= _percentileCount) {
+            return 0;
+        }
+        float sum = 0;
+        uint32_t count = 0;
+        for(int i = 0; i < windowPanes(); i++) {
+            Pane& pane = _panes[(_newest + PANES - i) % PANES];
+            sum += pane.quantiles[index].estimate(_percentiles[index], pane.stats.count()) * pane.stats.count();
+            count += pane.stats.count();
+        }
+        return count > 0 ? sum / count : 0;
+    };
+
+    using StateObjectPublisher::printValue;
+    const char* typeName() {
+        return _typeName;
+    };
+    void describe(TypeDescriptor& type) {
+        type.setDescription("Summary of the values over a time window")
+            .addProperty<unsigned long>("Count")
+            .addProperty<double>("Min")
+            .addProperty<double>("Max")
+            .addProperty<double>("Mean")
+            .addProperty<double>("StdDev");
+        for(int i = 0; i < _percentileCount; i++) {
+            type.addProperty<double>(_names[i], "Percentile (estimate)");
+        }
+        type.addProperty<unsigned long>("Window", "ms covered by the summary");
+    };
+    // A window has ended since the last push, with values
+    bool hasValue() {
+        advance(millis());
+        return _closed != _pushed && count() > 0;
+    };
+    size_t printValue(Print& out, unsigned long now) {
+        advance(now);
+        RunningStats stats = summary();
+        size_t length = out.print("{\"Count\":");
+        length += out.print(stats.count());
+        length += printNumber(out, "Min", stats.minimum());
+        length += printNumber(out, "Max", stats.maximum());
+        length += printNumber(out, "Mean", stats.mean());
+        length += printNumber(out, "StdDev", stats.stddev());
+        for(int i = 0; i < _percentileCount; i++) {
+            length += printNumber(out, _names[i], percentile(i));
+        }
+        length += out.print(",\"Window\":");
+        length += out.print(windowPanes() * _paneLength);
+        length += out.print('}');
+        _printed = _closed;
+        return length;
+    };
+    void pushed() {
+        _pushed = _printed;
+    };
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include <Constellation.h>
+
+/* Throughput of BufferedPrint : the header lines of a request printed piece by piece (as the library does), sent as is,
+   through the previous BufferedPrint (byte per byte) or through the current one, to a sink counting the writes
+   that would reach the network client. No network needed. */
+
+#define ITERATIONS 2000
+
+/* Stands for the network client : each write is a TCP segment (or a syscall) */
+class CountingPrint : public Print {
+  public:
+    unsigned long bytes = 0;
+    unsigned long writes = 0;
+    uint8_t checksum = 0;
+
+    using Print::write;
+    size_t write(uint8_t c) {
+      checksum += c;
+      bytes++;
+      writes++;
+      return 1;
+    }
+    size_t write(const uint8_t* data, size_t size) {
+      if(size == 0) {
+        return 0;
+      }
+      for(size_t i = 0; i < size; i++) {
+        checksum += data[i];
+      }
+      bytes += size;
+      writes++;
+      return size;
+    }
+};
+
+/* The previous BufferedPrint : every byte goes through write(uint8_t), the buffer is sent as a C string */
+template <size_t CAPACITY>
+class OldBufferedPrint : public Print {
+  public:
+    OldBufferedPrint(Print& destination) : _destination(destination), _size(0) {}
+
+    ~OldBufferedPrint() { flush(); }
+
+    virtual size_t write(uint8_t c) {
+      _buffer[_size++] = c;
+      if (_size + 1 == CAPACITY) {
+        flush();
+      }
+      return 1;
+    }
+
+    void flush() {
+      _buffer[_size] = '\0';
+      _destination.print(_buffer);
+      _size = 0;
+    }
+
+  private:
+    Print& _destination;
+    size_t _size;
+    char _buffer[CAPACITY];
+};
+
+void printHeader(Print& out, const char* name, const char* value) {
+  out.print(name);
+  out.print(": ");
+  out.print(value);
+  out.print("\r\n");
+}
+
+void printRequest(Print& out) {
+  out.print("GET /rest/constellation/PushStateObject HTTP/1.1\r\n");
+  printHeader(out, "Host", "constellation.local");
+  printHeader(out, "SentinelName", "MySentinel");
+  printHeader(out, "PackageName", "MyPackage");
+  printHeader(out, "AccessKey", "0123456789abcdef0123456789abcdef");
+  printHeader(out, "User-Agent", "ConstellationArduinoLib");
+  printHeader(out, "Connection", "keep-alive");
+  out.print("\r\n");
+}
+
+void report(const char* name, unsigned long elapsed, CountingPrint& sink) {
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(elapsed * 1000.0 / sink.bytes);
+  Serial.print(" ns/byte, ");
+  Serial.print((float)sink.writes / ITERATIONS);
+  Serial.println(" writes per request");
+}
+
+void runUnbuffered() {
+  CountingPrint sink;
+  unsigned long start = micros();
+  for(int i = 0; i < ITERATIONS; i++) {
+    printRequest(sink);
+  }
+  report("Unbuffered", micros() - start, sink);
+}
+
+template<size_t CAPACITY>
+void runBuffered(const char* name) {
+  CountingPrint sink;
+  unsigned long start = micros();
+  for(int i = 0; i < ITERATIONS; i++) {
+    BufferedPrint<CAPACITY> buffer(sink);
+    printRequest(buffer);
+    buffer.flush();
+  }
+  report(name, micros() - start, sink);
+}
+
+template<size_t CAPACITY>
+void runOldBuffered(const char* name) {
+  CountingPrint sink;
+  unsigned long start = micros();
+  for(int i = 0; i < ITERATIONS; i++) {
+    OldBufferedPrint<CAPACITY> buffer(sink);
+    printRequest(buffer);
+    buffer.flush();
+  }
+  report(name, micros() - start, sink);
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+
+  runUnbuffered();
+  runOldBuffered<64>("Old BufferedPrint<64>");
+  runOldBuffered<256>("Old BufferedPrint<256>");
+  runBuffered<64>("BufferedPrint<64>");
+  runBuffered<256>("BufferedPrint<256>");
+}
+
+void loop(void) {
+}
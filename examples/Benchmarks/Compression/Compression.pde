@@ -0,0 +1,184 @@
+#include <Constellation.h>
+#include <SimClient.h>
+
+/* Compressed responses (see setCompression) : a simulated server (see SimClient.h) answers GetSettings with a 1.2 KB
+   settings object, uncompressed or gzip-compressed when asked for. Compares the bytes on the wire and the time per
+   request. The inflater of this sketch has a 1 KB window : in the last scenario, the server compresses with the
+   default zlib window (32 KB), the first response can't be decoded, the request is sent again uncompressed and the
+   compression stays disabled. No network needed. */
+
+#define REQUESTS 200
+#define SCENES 10
+
+struct BenchmarkProfile : public DefaultProfile {
+  static const size_t InflateWindowSize = 1024;
+};
+Constellation<SimClient, BenchmarkProfile> constellation("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+
+// connectTime, rtt, jitter, bandwidth, chunkSize, chunkGap, maxAvailable, refuseEvery, resetEvery, halfOpenEvery
+SimConditions instant = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/* The settings, built in setup() : {"Scene1":"<id> <16 words>", ... "Scene10":"...", "Default":"<same as Scene1>"} */
+char settings[1400];
+
+/* The settings compressed by gzip (zlib level 9) with a 1 KB window (windowBits 10) */
+const uint8_t gzipWindow1K[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x5d, 0x92, 0x4b, 0x72, 0xc3, 0x20,
+  0x0c, 0x86, 0xaf, 0xe2, 0xf1, 0xba, 0x0b, 0xe3, 0x07, 0x76, 0xba, 0xee, 0x0d, 0x72, 0x02, 0x07,
+  0x70, 0xe2, 0xa9, 0x03, 0x9d, 0xc4, 0x6d, 0x16, 0x9d, 0xde, 0xbd, 0x02, 0x49, 0x44, 0x64, 0x61,
+  0x5e, 0x16, 0xff, 0x27, 0xfd, 0xe8, 0xb7, 0x3e, 0x1a, 0xe7, 0x9d, 0xaa, 0xdf, 0xeb, 0x5e, 0x19,
+  0xad, 0xf4, 0xe8, 0xaa, 0xd3, 0xb6, 0x7a, 0x5b, 0x85, 0x2f, 0xe7, 0xc5, 0x60, 0x43, 0xb8, 0xe1,
+  0xea, 0xee, 0xfc, 0x1d, 0xd6, 0x9f, 0xeb, 0x6e, 0x2e, 0xb0, 0xbd, 0x86, 0x7d, 0x0d, 0xbe, 0xf2,
+  0xeb, 0xf9, 0xb2, 0x57, 0x66, 0x0b, 0x77, 0x47, 0x23, 0xca, 0x9c, 0x9c, 0xbd, 0x85, 0x70, 0xa5,
+  0x5d, 0x8a, 0xaa, 0xdf, 0x10, 0xda, 0x02, 0x54, 0xb7, 0x9d, 0xd2, 0x9d, 0x75, 0x59, 0x2e, 0x71,
+  0x50, 0x2c, 0x5f, 0xa5, 0x99, 0x43, 0x78, 0x1f, 0x96, 0xa5, 0xb2, 0x2b, 0xcc, 0x9e, 0x88, 0x7c,
+  0xc0, 0x81, 0x0f, 0x40, 0x86, 0x47, 0xca, 0x9a, 0x99, 0x1d, 0x30, 0x3b, 0x65, 0xdb, 0xd6, 0x4e,
+  0x03, 0x17, 0xca, 0xd7, 0xa9, 0xb0, 0x6d, 0xfd, 0x59, 0xfd, 0xf9, 0x25, 0x87, 0x8b, 0x9b, 0x77,
+  0xfe, 0x83, 0x7e, 0x00, 0x07, 0x3d, 0x01, 0x68, 0x96, 0x40, 0x22, 0xc3, 0x7a, 0x80, 0xa9, 0x45,
+  0xcd, 0xfd, 0x69, 0xd4, 0xa8, 0x80, 0xa2, 0xe9, 0x0a, 0x7c, 0xb8, 0x93, 0x23, 0x67, 0x9e, 0x82,
+  0x39, 0xfd, 0xec, 0x31, 0x4d, 0x11, 0x9d, 0x02, 0x28, 0x9a, 0x71, 0x03, 0xe0, 0x5a, 0x6b, 0xe7,
+  0xae, 0x71, 0x7d, 0xa9, 0xf4, 0xb4, 0x87, 0x24, 0x44, 0x32, 0xd9, 0xd5, 0x64, 0xc6, 0x96, 0xce,
+  0x70, 0x4c, 0x75, 0x92, 0x0d, 0xec, 0x14, 0x5a, 0xc0, 0x44, 0x0d, 0xc4, 0x41, 0x1f, 0x9a, 0xc1,
+  0x9a, 0x21, 0xc9, 0x4b, 0x17, 0x64, 0xba, 0xd8, 0x47, 0x1e, 0x5f, 0x28, 0xba, 0x46, 0x21, 0x69,
+  0x4d, 0x71, 0x9c, 0x08, 0x12, 0xe3, 0xad, 0x12, 0x36, 0xc6, 0x76, 0xd1, 0xa6, 0x55, 0xa6, 0xd1,
+  0xc2, 0x9b, 0x2c, 0x89, 0x39, 0x8a, 0x7a, 0xf1, 0x79, 0xb8, 0x32, 0x71, 0xc6, 0x24, 0x7a, 0x4f,
+  0xfc, 0xff, 0x62, 0xe6, 0x14, 0x4b, 0xeb, 0xa6, 0xa5, 0xb7, 0xc3, 0x98, 0x2f, 0x08, 0x07, 0x73,
+  0xbf, 0x62, 0x03, 0x96, 0xbd, 0x93, 0xfb, 0x81, 0xdb, 0x87, 0x76, 0xe8, 0x62, 0xf4, 0x82, 0x54,
+  0xd2, 0x09, 0x23, 0x0f, 0x80, 0x6c, 0xcc, 0xe4, 0x7a, 0xd3, 0x2c, 0xfc, 0x04, 0x00, 0x64, 0x0d,
+  0x71, 0x1b, 0x2d, 0x2a, 0x6d, 0x96, 0xef, 0x47, 0x47, 0x94, 0x4d, 0xd9, 0x3d, 0x49, 0xa0, 0xec,
+  0x53, 0xd5, 0xc4, 0x62, 0xc7, 0xc9, 0xb6, 0xc3, 0xe8, 0x64, 0x6f, 0xc8, 0x2e, 0x13, 0x55, 0xca,
+  0xda, 0x11, 0x4b, 0xa9, 0xd0, 0x94, 0xbb, 0x85, 0xe2, 0xb9, 0x82, 0x88, 0x06, 0xe6, 0x87, 0x5b,
+  0xe6, 0xef, 0x6d, 0x07, 0x66, 0xaf, 0x8c, 0x56, 0x7a, 0x2c, 0x9c, 0x79, 0x0e, 0xf8, 0x7e, 0x71,
+  0xf5, 0xc2, 0xa5, 0x4a, 0x30, 0x47, 0xb4, 0x56, 0x1a, 0x5c, 0x1a, 0x96, 0xa2, 0xea, 0xbf, 0x7f,
+  0x8e, 0x31, 0xe9, 0xc6, 0xe9, 0x04, 0x00, 0x00
+};
+
+/* The same with the default window (windowBits 15) : "Default" refers back to "Scene1", 1.1 KB before */
+const uint8_t gzipWindow32K[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xbd, 0x54, 0x4b, 0x76, 0x83, 0x30,
+  0x0c, 0xbc, 0x0a, 0x8f, 0x75, 0x17, 0xd8, 0x80, 0x21, 0x5d, 0xf7, 0x06, 0x39, 0x01, 0xb1, 0x4d,
+  0xc2, 0x2b, 0xb1, 0xfb, 0x12, 0xda, 0x2c, 0xfa, 0x7a, 0xf7, 0x0a, 0x4b, 0x72, 0xe5, 0x1c, 0xa0,
+  0x8b, 0xf8, 0x87, 0x3c, 0x23, 0x8d, 0xc6, 0xf9, 0xae, 0x8f, 0xd6, 0x07, 0xaf, 0xea, 0xd7, 0xba,
+  0x53, 0xd6, 0x28, 0x33, 0xf8, 0xea, 0xb4, 0x2e, 0xc1, 0x55, 0xf1, 0xc3, 0x07, 0x31, 0xb8, 0x18,
+  0x6f, 0xb8, 0xba, 0xfb, 0x70, 0x87, 0xf5, 0xfb, 0xb2, 0xd9, 0x0b, 0x6c, 0xaf, 0x71, 0x5b, 0x62,
+  0xa8, 0xc2, 0x72, 0xbe, 0x6c, 0x95, 0x5d, 0xe3, 0xdd, 0xd3, 0x88, 0x30, 0x27, 0xef, 0x6e, 0x31,
+  0x5e, 0x69, 0x97, 0xa2, 0xea, 0x17, 0x24, 0xd5, 0x40, 0x6a, 0x74, 0xab, 0x4c, 0xeb, 0x7c, 0x86,
+  0x4b, 0x3c, 0x08, 0x96, 0xaf, 0xd2, 0xcc, 0x21, 0xbc, 0x8f, 0xf3, 0x5c, 0xb9, 0x05, 0xe6, 0x40,
+  0x8c, 0x7c, 0xc0, 0x81, 0x0f, 0xa0, 0x8c, 0x8f, 0x94, 0x35, 0x73, 0xb6, 0xc0, 0xd9, 0x2a, 0xa7,
+  0xb5, 0x1b, 0x7b, 0x2e, 0x94, 0xaf, 0x53, 0x61, 0xeb, 0xf2, 0xb5, 0x84, 0xf3, 0x53, 0x0e, 0x17,
+  0x3f, 0x6d, 0xfc, 0x05, 0xf5, 0x00, 0x1e, 0xd4, 0x04, 0x48, 0x33, 0x04, 0x32, 0x32, 0x59, 0x07,
+  0x64, 0x6a, 0x56, 0x53, 0x77, 0x1a, 0x0c, 0x22, 0x20, 0x68, 0xba, 0x02, 0x3f, 0xdc, 0xc9, 0x91,
+  0x33, 0x4f, 0xc1, 0x9c, 0x7e, 0xd6, 0x98, 0xa6, 0x9d, 0x3a, 0x05, 0x50, 0x34, 0xd3, 0xf5, 0x40,
+  0xa7, 0x9d, 0x9b, 0xda, 0xc6, 0x77, 0x25, 0xd2, 0x9f, 0x3c, 0x04, 0x21, 0x92, 0xc9, 0xaa, 0x26,
+  0x31, 0xd6, 0x74, 0x86, 0x63, 0xaa, 0x93, 0x64, 0x60, 0xa5, 0x50, 0x02, 0x66, 0x34, 0xc0, 0xd8,
+  0x9b, 0x43, 0xd3, 0x3b, 0xdb, 0x27, 0x78, 0xa9, 0x82, 0x4c, 0x17, 0x7d, 0x14, 0xb0, 0x43, 0xbb,
+  0x6a, 0x14, 0x92, 0xd6, 0x14, 0xc7, 0x89, 0x20, 0xe3, 0x7e, 0xab, 0x24, 0x1b, 0x76, 0xbb, 0x18,
+  0xab, 0x95, 0x6d, 0x8c, 0xd0, 0x26, 0x43, 0x62, 0x8e, 0xa2, 0x5e, 0x6c, 0x0f, 0x57, 0x26, 0xce,
+  0x98, 0x89, 0xfa, 0x89, 0xdf, 0x9f, 0xc4, 0x1c, 0xf7, 0xd2, 0xda, 0x71, 0xee, 0x5c, 0x3f, 0xe4,
+  0x0b, 0x42, 0xc1, 0xec, 0x57, 0x34, 0x60, 0xe9, 0x9d, 0xec, 0x07, 0xb6, 0x8f, 0x7c, 0x11, 0x49,
+  0x0b, 0x42, 0x49, 0x27, 0x4c, 0x79, 0x00, 0xca, 0xc6, 0x8e, 0xbe, 0xb3, 0xcd, 0xcc, 0x2d, 0x00,
+  0xc2, 0xf2, 0x05, 0x89, 0xa6, 0x94, 0x32, 0xcb, 0xfe, 0xd1, 0x11, 0x65, 0x53, 0xba, 0x27, 0x01,
+  0x94, 0x3e, 0x55, 0xcd, 0x5e, 0xec, 0x30, 0x3a, 0xdd, 0xc3, 0xf3, 0x17, 0xde, 0x90, 0x2e, 0x13,
+  0x55, 0xca, 0xda, 0x91, 0x96, 0x52, 0xa1, 0x29, 0xbb, 0x85, 0xe2, 0xf3, 0x83, 0xc5, 0x87, 0xf8,
+  0xe6, 0xe7, 0xe9, 0x73, 0xdd, 0xfe, 0xf5, 0x2f, 0xe7, 0xe7, 0x17, 0x8e, 0x31, 0xe9, 0xc6, 0xe9,
+  0x04, 0x00, 0x00
+};
+
+const uint8_t* compressed = NULL;
+size_t compressedSize = 0;
+unsigned long compressedResponses = 0;
+
+uint32_t seed = 1;
+uint16_t nextRandom() {
+  seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF;
+  return seed >> 16;
+}
+
+void buildSettings() {
+  static const char* words[] = { "light", "blind", "door", "window", "sensor", "living", "kitchen", "bedroom",
+                                 "on", "off", "dim", "open", "close", "motion", "heat", "night" };
+  char first[160];
+  size_t length = snprintf(settings, sizeof(settings), "{");
+  for(int i = 0; i < SCENES; i++) {
+    char value[160];
+    uint16_t high = nextRandom();
+    uint16_t low = nextRandom();
+    size_t size = snprintf(value, sizeof(value), "%04x%04x", high, low);
+    for(int w = 0; w < 16; w++) {
+      size += snprintf(value + size, sizeof(value) - size, " %s", words[nextRandom() % 16]);
+    }
+    if(i == 0) {
+      strcpy(first, value);
+    }
+    length += snprintf(settings + length, sizeof(settings) - length, "%s\"Scene%d\":\"%s\"", i > 0 ? "," : "", i + 1, value);
+  }
+  snprintf(settings + length, sizeof(settings) - length, ",\"Default\":\"%s\"}", first);
+}
+
+unsigned long server(const char* request, Print& response, void* context) {
+  if(strstr(request, "/GetSettings") == NULL) {
+    response.print("HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n");
+    return 0;
+  }
+  bool gzip = compressed != NULL && strstr(request, "\r\nAccept-Encoding: gzip") != NULL;
+  response.print("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n");
+  if(gzip) {
+    response.print("Content-Encoding: gzip\r\n");
+    compressedResponses++;
+  }
+  response.print("Content-Length: ");
+  response.print(gzip ? compressedSize : strlen(settings));
+  response.print("\r\n\r\n");
+  if(gzip) {
+    response.write(compressed, compressedSize);
+  }
+  else {
+    response.print(settings);
+  }
+  return 0;
+}
+
+void runScenario(const char* name, const uint8_t* stream, size_t size) {
+  SimNetwork::instance().begin(server, NULL, instant);
+  constellation.setCompression(stream != NULL);
+  compressed = stream;
+  compressedSize = size;
+  compressedResponses = 0;
+  unsigned long retries = constellation.getConnectionStats().retries;
+  const SimStats& stats = SimNetwork::instance().stats;
+
+  int failed = 0;
+  unsigned long start = micros();
+  for(int i = 0; i < REQUESTS; i++) {
+    // Only compared : the object returned lives in a buffer of getSettings()
+    if(&constellation.getSettings() == &JsonObject::invalid()) {
+      failed++;
+    }
+  }
+  unsigned long elapsed = micros() - start;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print((float)stats.bytesReceived / REQUESTS);
+  Serial.print(" bytes per response, ");
+  Serial.print((float)elapsed / REQUESTS);
+  Serial.print(" us per request, ");
+  Serial.print(compressedResponses);
+  Serial.print(" compressed, ");
+  Serial.print(constellation.getConnectionStats().retries - retries);
+  Serial.print(" retried, ");
+  Serial.print(failed);
+  Serial.println(" failed");
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  constellation.setDebugMode(Error);
+  buildSettings();
+
+  runScenario("Uncompressed", NULL, 0);
+  runScenario("gzip, 1 KB window", gzipWindow1K, sizeof(gzipWindow1K));
+  runScenario("gzip, 32 KB window", gzipWindow32K, sizeof(gzipWindow32K));
+}
+
+void loop(void) {
+}
@@ -0,0 +1,177 @@
+#include <Constellation.h>
+#include <SimClient.h>
+
+/* MessagePack vs JSON for the incoming messages : a simulated server (see SimClient.h) answers GetMessages with the
+   same messages in JSON, or in MessagePack when asked for (setMessagePack). Compares the bytes on the wire and the
+   time per long-poll through the library, then the decoding alone : ArduinoJson parsing the JSON text against the
+   MessagePack reader building the same JSON document. No network needed, but too large for the AVR boards. */
+
+#define POLLS 200
+#define ITERATIONS 2000
+#define BUFFER_SIZE 1024
+#define JSON_BUFFER_SIZE 2048
+
+/* One instance per format */
+Constellation<SimClient> jsonClient("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+Constellation<SimClient> messagePackClient("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+
+// connectTime, rtt, jitter, bandwidth, chunkSize, chunkGap, maxAvailable, refuseEvery, resetEvery, halfOpenEvery
+// Instant link : the time per poll is the time spent by the library (and the simulated server)
+SimConditions instant = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/* The messages of each GetMessages response */
+const char messagesJson[] = "["
+  "{\"Key\":\"Temperature\",\"Data\":21.5,\"Scope\":{\"Scope\":4},\"Sender\":{\"Type\":1,\"FriendlyName\":\"Consumer/Dashboard\",\"ConnectionId\":\"6f2c6a1e-1d9b-4f83-9b8e-52a0b4c1d7e3\"}},"
+  "{\"Key\":\"SetLight\",\"Data\":[3,true,255],\"Scope\":{\"Scope\":4},\"Sender\":{\"Type\":1,\"FriendlyName\":\"Consumer/Dashboard\",\"ConnectionId\":\"6f2c6a1e-1d9b-4f83-9b8e-52a0b4c1d7e3\"}},"
+  "{\"Key\":\"Notify\",\"Data\":{\"Title\":\"Front door\",\"Level\":2,\"Time\":1529331402},\"Scope\":{\"Scope\":3,\"SagaId\":\"b7f1e0c2-5a4d-4e8f-9c3b-1d2e3f4a5b6c\"},\"Sender\":{\"Type\":0,\"FriendlyName\":\"MyPackage\",\"ConnectionId\":\"0c9d8e7f-6a5b-4c3d-2e1f-0a9b8c7d6e5f\"}},"
+  "{\"Key\":\"Ping\",\"Data\":null,\"Scope\":{\"Scope\":4},\"Sender\":{\"Type\":1,\"FriendlyName\":\"Consumer/Dashboard\",\"ConnectionId\":\"6f2c6a1e-1d9b-4f83-9b8e-52a0b4c1d7e3\"}}"
+  "]";
+#define MESSAGES_PER_POLL 4
+
+/* The same messages in MessagePack, encoded in setup() */
+uint8_t messagesMessagePack[BUFFER_SIZE];
+size_t messagesMessagePackSize = 0;
+
+/* Print writing in a byte array */
+class ArrayPrint : public Print {
+  public:
+    uint8_t* data;
+    size_t size = 0;
+    size_t capacity;
+
+    ArrayPrint(uint8_t* data, size_t capacity) : data(data), capacity(capacity) {}
+
+    using Print::write;
+    size_t write(uint8_t c) {
+      return write(&c, 1);
+    }
+    size_t write(const uint8_t* buffer, size_t length) {
+      if(size + length > capacity) {
+        return 0;
+      }
+      memcpy(data + size, buffer, length);
+      size += length;
+      return length;
+    }
+};
+
+unsigned long received = 0;
+
+unsigned long respond(Print& response, int code, const char* contentType, const uint8_t* body, size_t length) {
+  response.print("HTTP/1.1 ");
+  response.print(code);
+  response.print(" OK\r\nContent-Type: ");
+  response.print(contentType);
+  response.print("\r\nContent-Length: ");
+  response.print(length);
+  response.print("\r\n\r\n");
+  response.write(body, length);
+  return 0;
+}
+
+unsigned long server(const char* request, Print& response, void* context) {
+  if(strstr(request, "/SubscribeToMessage") != NULL) {
+    const char* id = "\"00000000-0000-0000-0000-000000000000\"";
+    return respond(response, 200, "application/json", (const uint8_t*)id, strlen(id));
+  }
+  if(strstr(request, "/GetMessages") != NULL) {
+    if(strstr(request, "\r\nAccept: " MESSAGEPACK_CONTENT_TYPE) != NULL) {
+      return respond(response, 200, MESSAGEPACK_CONTENT_TYPE, messagesMessagePack, messagesMessagePackSize);
+    }
+    return respond(response, 200, "application/json", (const uint8_t*)messagesJson, strlen(messagesJson));
+  }
+  return respond(response, 204, "application/json", NULL, 0);
+}
+
+void runPolls(const char* name, Constellation<SimClient>& constellation) {
+  constellation.setDebugMode(Error);
+  constellation.setMessageReceiveCallback([](JsonObject& json) {
+    received++;
+  });
+  constellation.subscribeToMessage();
+  constellation.checkIncomingMessage();   // sends the first GetMessages
+
+  received = 0;
+  const SimStats& stats = SimNetwork::instance().stats;
+  uint32_t bytes = stats.bytesReceived;
+  unsigned long start = micros();
+  for(int i = 0; i < POLLS; i++) {
+    constellation.checkIncomingMessage();
+  }
+  unsigned long elapsed = micros() - start;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print((float)(stats.bytesReceived - bytes) / POLLS);
+  Serial.print(" bytes per response, ");
+  Serial.print((float)elapsed / POLLS);
+  Serial.print(" us per poll, ");
+  Serial.print(received);
+  Serial.print("/");
+  Serial.print(POLLS * MESSAGES_PER_POLL);
+  Serial.println(" messages");
+}
+
+/* Decoding alone : the input is copied first, both are decoded in place */
+void runDecode() {
+  static char buffer[BUFFER_SIZE];
+  unsigned long errors = 0;
+  unsigned long start = micros();
+  for(int i = 0; i < ITERATIONS; i++) {
+    memcpy(buffer, messagesJson, sizeof(messagesJson));
+    StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
+    JsonArray& array = jsonBuffer.parseArray(buffer);
+    if(!array.success() || array.size() != MESSAGES_PER_POLL) {
+      errors++;
+    }
+  }
+  unsigned long jsonTime = micros() - start;
+
+  start = micros();
+  for(int i = 0; i < ITERATIONS; i++) {
+    memcpy(buffer, messagesMessagePack, messagesMessagePackSize);
+    StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
+    MessagePackReader reader((uint8_t*)buffer, messagesMessagePackSize);
+    JsonVariant root = reader.toJson(jsonBuffer);
+    if(reader.error() || root.as<JsonArray&>().size() != MESSAGES_PER_POLL) {
+      errors++;
+    }
+  }
+  unsigned long messagePackTime = micros() - start;
+
+  Serial.print("Decode, ArduinoJson parseArray: ");
+  Serial.print((float)jsonTime / ITERATIONS);
+  Serial.println(" us");
+  Serial.print("Decode, MessagePackReader: ");
+  Serial.print((float)messagePackTime / ITERATIONS);
+  Serial.print(" us, ");
+  Serial.print(errors);
+  Serial.println(" errors");
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+
+  // Encode the messages in MessagePack
+  static char json[sizeof(messagesJson)];
+  memcpy(json, messagesJson, sizeof(messagesJson));
+  StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
+  JsonArray& messages = jsonBuffer.parseArray(json);
+  ArrayPrint out(messagesMessagePack, sizeof(messagesMessagePack));
+  MessagePackWriter(out).write(messages);
+  messagesMessagePackSize = out.size;
+
+  Serial.print("Body: JSON ");
+  Serial.print(strlen(messagesJson));
+  Serial.print(" bytes, MessagePack ");
+  Serial.print(messagesMessagePackSize);
+  Serial.println(" bytes");
+
+  SimNetwork::instance().begin(server, NULL, instant);
+  runPolls("JSON", jsonClient);
+  messagePackClient.setMessagePack(true);
+  runPolls("MessagePack", messagePackClient);
+  runDecode();
+}
+
+void loop(void) {
+}
@@ -0,0 +1,105 @@
+#include <Constellation.h>
+#include <SimClient.h>
+
+/* Several threads publishing through one instance (network task mode : Linux & ESP32) : the requests go through the
+   lock-free outbound queue (see MpscQueue.h) to the connection of the network task. The simulated server checks that
+   every request arrives, in the order of its thread. No network needed. */
+
+#ifdef CONSTELLATION_NETWORK_TASK
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define REQUESTS_PER_THREAD 2000
+#define MAX_THREADS 8
+
+/* A deeper bulk lane than the default one */
+struct BenchmarkProfile : public DefaultProfile {
+  static const unsigned int NetworkQueueLength = 64;
+};
+Constellation<SimClient, BenchmarkProfile> constellation("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+
+// connectTime, rtt, jitter, bandwidth, chunkSize, chunkGap, maxAvailable, refuseEvery, resetEvery, halfOpenEvery
+SimConditions lan = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/* Written by the network task only */
+int nextRequest[MAX_THREADS];
+std::atomic<unsigned long> received(0);
+unsigned long errors = 0;
+
+unsigned long server(const char* request, Print& response, void* context) {
+  // The logs are "<thread>-<index>"
+  const char* message = strstr(request, "message=");
+  int thread, index;
+  if(message != NULL) {
+    if(sscanf(message + 8, "%d-%d", &thread, &index) != 2 || thread < 0 || thread >= MAX_THREADS || nextRequest[thread]++ != index) {
+      errors++;
+    }
+    received++;
+  }
+  response.print("HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n");
+  return 0;
+}
+
+void publisher(int thread) {
+  for(int i = 0; i < REQUESTS_PER_THREAD; i++) {
+    // Retried while the queue is full
+    while(!constellation.writeInfo("%d-%d", thread, i)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void runThreads(int count) {
+  received = 0;
+  errors = 0;
+  for(int i = 0; i < MAX_THREADS; i++) {
+    nextRequest[i] = 0;
+  }
+  unsigned long start = millis();
+  std::vector<std::thread> threads;
+  for(int i = 0; i < count; i++) {
+    threads.push_back(std::thread(publisher, i));
+  }
+  for(size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+  unsigned long expected = (unsigned long)count * REQUESTS_PER_THREAD;
+  while(received < expected && millis() - start < 30000) {
+    delay(1);
+  }
+  unsigned long elapsed = millis() - start;
+
+  Serial.print(count);
+  Serial.print(" thread(s): ");
+  Serial.print(received.load());
+  Serial.print("/");
+  Serial.print(expected);
+  Serial.print(" requests, ");
+  Serial.print(errors);
+  Serial.print(" out of order, ");
+  Serial.print(elapsed > 0 ? received.load() * 1000.0 / elapsed : 0);
+  Serial.println(" requests/s");
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  constellation.setDebugMode(Off);   // a full queue is expected (logged as an error)
+  SimNetwork::instance().begin(server, NULL, lan);
+  constellation.startNetworkTask();
+
+  for(int count = 1; count <= MAX_THREADS; count *= 2) {
+    runThreads(count);
+  }
+  constellation.stopNetworkTask();
+}
+
+#else
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  Serial.println("This benchmark needs the network task mode (Linux or ESP32)");
+}
+#endif
+
+void loop(void) {
+}
@@ -0,0 +1,73 @@
+#include <Constellation.h>
+#include <SimClient.h>
+
+/* Jitter of the task scheduler : a sensor sampled every 10 ms next to a task pushing a StateObject every 500 ms over a
+   slow link (150 ms round trip, see SimClient.h). Without 'duringIO', the sampling waits for the end of each push ;
+   with it, the sampling also runs while the library waits for the response. No network needed. */
+
+#define SAMPLE_INTERVAL 10
+#define PUSH_INTERVAL 500
+#define DURATION 5000
+
+/* One instance per scenario : each has its own scheduler & lateness statistics */
+Constellation<SimClient> blocking("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+Constellation<SimClient> duringIO("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+Constellation<SimClient>* current;
+
+// connectTime, rtt, jitter, bandwidth, chunkSize, chunkGap, maxAvailable, refuseEvery, resetEvery, halfOpenEvery
+SimConditions slowLink = { 20, 150, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+unsigned long samples = 0;
+float lastValue = 0;
+
+unsigned long server(const char* request, Print& response, void* context) {
+  response.print("HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n");
+  return 0;
+}
+
+void sample() {
+  lastValue = 20 + (millis() % 1000) / 100.0;  // a simulated sensor
+  samples++;
+}
+
+void push() {
+  current->pushStateObject("Sensor", lastValue);
+}
+
+void runScenario(const char* name, Constellation<SimClient>& constellation, bool sampleDuringIO) {
+  current = &constellation;
+  samples = 0;
+  constellation.setDebugMode(Error);
+  int sensor = constellation.addTask(sample, SAMPLE_INTERVAL, sampleDuringIO);
+  constellation.addTask(push, PUSH_INTERVAL);
+
+  unsigned long start = millis();
+  while(millis() - start < DURATION) {
+    constellation.runTasks();
+    yield();
+  }
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(samples);
+  Serial.print(" samples (");
+  Serial.print(DURATION / SAMPLE_INTERVAL);
+  Serial.print(" expected), lateness max ");
+  Serial.print(constellation.getTaskMaxLateness(sensor));
+  Serial.print(" ms, p50 ");
+  Serial.print(constellation.getTaskLatenessPercentile(50));
+  Serial.print(" ms, p99 ");
+  Serial.print(constellation.getTaskLatenessPercentile(99));
+  Serial.println(" ms");
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  SimNetwork::instance().begin(server, NULL, slowLink);
+
+  runScenario("Sampling between the pushes", blocking, false);
+  runScenario("Sampling during the pushes", duringIO, true);
+}
+
+void loop(void) {
+}
@@ -0,0 +1,188 @@
+#include <Constellation.h>
+
+/* The scanning kernels of TextScan.h (see urlEncode & the response reader) on random input : each kernel available on
+   this target is checked against the reference (isUnreserved byte per byte, memchr) at every alignment, then timed.
+   No network needed. */
+
+#define BUFFER_SIZE 512
+#define ITERATIONS 2000
+
+/* 16 bytes of slack : the vector kernels read the whole aligned block of the terminator */
+uint8_t buffer[BUFFER_SIZE + 16] __attribute__((aligned(16)));
+unsigned long errors = 0;
+volatile size_t sink = 0;
+
+typedef size_t (*SpanKernel)(const char* text);
+typedef const uint8_t* (*NewlineKernel)(const uint8_t* data, size_t size);
+
+uint8_t randomUnreserved() {
+  uint8_t c;
+  do {
+    c = random(128);
+  } while(!isUnreserved(c));
+  return c;
+}
+
+uint8_t randomReserved() {
+  uint8_t c;
+  do {
+    c = random(256);
+  } while(isUnreserved(c));
+  return c;
+}
+
+// A run of 'length' unreserved characters at 'offset', then a reserved one (sometimes the terminator)
+void fillSpan(size_t offset, size_t length) {
+  for(size_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = random(256);
+  }
+  for(size_t i = 0; i < length; i++) {
+    buffer[offset + i] = randomUnreserved();
+  }
+  buffer[offset + length] = random(4) == 0 ? '\0' : randomReserved();
+  buffer[BUFFER_SIZE] = '\0';
+}
+
+// Random bytes without '\n' from 'offset', then a '\n' at 'offset' + 'position' (if in the buffer)
+void fillNewline(size_t offset, size_t position) {
+  for(size_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = random(256);
+    if(i >= offset && buffer[i] == '\n') {
+      buffer[i] = ' ';
+    }
+  }
+  if(offset + position < sizeof(buffer)) {
+    buffer[offset + position] = '\n';
+  }
+}
+
+size_t referenceSpan(const char* text) {
+  size_t length = 0;
+  while(isUnreserved(text[length])) {
+    length++;
+  }
+  return length;
+}
+
+const uint8_t* referenceNewline(const uint8_t* data, size_t size) {
+  return (const uint8_t*)memchr(data, '\n', size);
+}
+
+void checkSpan(const char* name, SpanKernel kernel) {
+  unsigned long failures = 0;
+  for(size_t offset = 0; offset < 16; offset++) {
+    for(size_t length = 0; offset + length < BUFFER_SIZE; length += 1 + random(8)) {
+      fillSpan(offset, length);
+      const char* text = (const char*)buffer + offset;
+      if(kernel(text) != referenceSpan(text)) {
+        failures++;
+      }
+    }
+  }
+  Serial.print(name);
+  Serial.println(failures == 0 ? ": OK" : ": FAILED");
+  errors += failures;
+}
+
+void checkNewline(const char* name, NewlineKernel kernel) {
+  unsigned long failures = 0;
+  for(size_t offset = 0; offset < 16; offset++) {
+    for(size_t size = 0; offset + size <= BUFFER_SIZE; size += 1 + random(8)) {
+      fillNewline(offset, random(size + 8));
+      if(kernel(buffer + offset, size) != referenceNewline(buffer + offset, size)) {
+        failures++;
+      }
+    }
+  }
+  Serial.print(name);
+  Serial.println(failures == 0 ? ": OK" : ": FAILED");
+  errors += failures;
+}
+
+void report(const char* name, unsigned long elapsed, unsigned long bytes) {
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(elapsed * 1000.0 / bytes);
+  Serial.println(" ns/byte");
+}
+
+// A URL-like text : runs of 1 to 32 unreserved characters between reserved ones
+void timeSpan(const char* name, SpanKernel kernel) {
+  randomSeed(1);
+  for(size_t i = 0; i < BUFFER_SIZE; i++) {
+    buffer[i] = random(32) == 0 ? randomReserved() : randomUnreserved();
+    if(buffer[i] == '\0') {
+      buffer[i] = ' ';
+    }
+  }
+  buffer[BUFFER_SIZE] = '\0';
+  unsigned long start = micros();
+  for(int i = 0; i < ITERATIONS; i++) {
+    const char* text = (const char*)buffer;
+    while(*text != '\0') {
+      text += kernel(text);
+      sink += *text;
+      if(*text != '\0') {
+        text++;
+      }
+    }
+  }
+  report(name, micros() - start, (unsigned long)ITERATIONS * BUFFER_SIZE);
+}
+
+// Header lines of 20 to 80 bytes
+void timeNewline(const char* name, NewlineKernel kernel) {
+  randomSeed(1);
+  fillNewline(0, sizeof(buffer));
+  for(size_t i = random(20, 80); i < BUFFER_SIZE; i += random(20, 80)) {
+    buffer[i] = '\n';
+  }
+  unsigned long start = micros();
+  for(int i = 0; i < ITERATIONS; i++) {
+    const uint8_t* data = buffer;
+    const uint8_t* end = buffer + BUFFER_SIZE;
+    const uint8_t* newline;
+    while((newline = kernel(data, end - data)) != NULL) {
+      data = newline + 1;
+    }
+    sink += data - buffer;
+  }
+  report(name, micros() - start, (unsigned long)ITERATIONS * BUFFER_SIZE);
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  randomSeed(1);
+
+  Serial.println("unreservedSpan vs isUnreserved");
+  checkSpan("Bytes", unreservedSpanBytes);
+#if defined(SCAN_SSE2) || defined(SCAN_NEON)
+  checkSpan("Vector", unreservedSpanVector);
+#endif
+  checkSpan("unreservedSpan", unreservedSpan);
+
+  Serial.println("findNewline vs memchr");
+  checkNewline("Bytes", findNewlineBytes);
+#ifdef SCAN_WORDS
+  checkNewline("Words", findNewlineWords);
+#endif
+  checkNewline("findNewline", findNewline);
+
+  Serial.println("unreservedSpan, runs of 1 to 32 characters");
+  timeSpan("Bytes", unreservedSpanBytes);
+#if defined(SCAN_SSE2) || defined(SCAN_NEON)
+  timeSpan("Vector", unreservedSpanVector);
+#endif
+
+  Serial.println("findNewline, lines of 20 to 80 bytes");
+  timeNewline("Bytes", findNewlineBytes);
+#ifdef SCAN_WORDS
+  timeNewline("Words", findNewlineWords);
+#endif
+  timeNewline("memchr", referenceNewline);
+
+  Serial.println(errors == 0 ? "All kernels agree" : "FAILED");
+}
+
+void loop(void) {
+}
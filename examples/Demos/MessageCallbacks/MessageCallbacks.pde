@@ -114,8 +114,18 @@ void setup(void) {
       else {
         constellation.writeInfo("No saga, no response !");
       }
-   });   
-  
+   });
+
+  // Expose a typed MessageCallback : the parameters are bound and checked from the 'Data' (the missing ones are added to the descriptor)
+  constellation.registerMessageCallback<int, int>("Multiply",
+    MessageCallbackDescriptor().setDescription("Do multiplication on this tiny device").addParameter<int>("a").addParameter<int>("b").setReturnType<int>(),
+    [](int a, int b, MessageContext ctx) {
+      constellation.writeInfo("Multiplication %d * %d = %d", a, b, a * b);
+      if(ctx.isSaga) {
+        constellation.sendResponse(ctx, a * b);
+      }
+   });
+
   // Declare the package descriptor
   constellation.declarePackageDescriptor();
 
@@ -0,0 +1,125 @@
+#include <Constellation.h>
+#include <SimClient.h>
+
+/* No network needed : Constellation talks to a server simulated in this sketch, through a simulated link (see SimClient.h) */
+
+/* Create the Constellation client on the simulated network */
+Constellation<SimClient> constellation("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+
+/* The link conditions to compare */
+typedef struct {
+  const char* name;
+  SimConditions conditions;
+} Scenario;
+// connectTime, rtt, jitter, bandwidth, chunkSize, chunkGap, maxAvailable, refuseEvery, resetEvery, halfOpenEvery
+Scenario scenarios[] = {
+  { "LAN",                  {  1,  1,  0,       0,   0,  0, 0, 0, 0,  0 } },
+  { "WiFi",                 { 20, 10, 20,  200000, 536,  2, 0, 0, 0,  0 } },
+  { "WiFi, 1 byte reads",   { 20, 10, 20,  200000, 536,  2, 1, 0, 0,  0 } },
+  { "Lossy (resets)",       { 20, 10, 20,  200000, 536,  2, 0, 0, 5,  0 } },
+  { "Half-open sockets",    { 20, 10, 20,  200000, 536,  2, 0, 0, 0, 10 } }
+};
+
+/* The simulated server : a message "Tick" is published every TICK_INTERVAL ms, with its publication time as Data */
+#define TICK_INTERVAL 250
+unsigned long nextTick = 0;
+unsigned long tickCount = 0, tickLatency = 0;
+
+unsigned long respond(Print& response, int code, const char* body) {
+  response.print("HTTP/1.1 ");
+  response.print(code);
+  response.print(" OK\r\nContent-Type: application/json\r\nContent-Length: ");
+  response.print(strlen(body));
+  response.print("\r\n\r\n");
+  response.print(body);
+  return 0;
+}
+
+unsigned long server(const char* request, Print& response, void* context) {
+  if(strstr(request, "/SubscribeToMessage?") != NULL || strstr(request, "/SubscribeToMessage ") != NULL) {
+    return respond(response, 200, "\"00000000-0000-0000-0000-000000000000\"");
+  }
+  if(strstr(request, "/GetMessages") != NULL) {
+    // Long-poll : the response is held until the next tick
+    char body[128];
+    snprintf(body, sizeof(body), "[{\"Key\":\"Tick\",\"Data\":%lu,\"Scope\":{\"Scope\":3},\"Sender\":{\"Type\":1,\"FriendlyName\":\"Sim\"}}]", nextTick);
+    unsigned long now = millis();
+    unsigned long wait = (long)(nextTick - now) > 0 ? nextTick - now : 0;
+    nextTick += TICK_INTERVAL;
+    respond(response, 200, body);
+    return wait;
+  }
+  return respond(response, 204, "");
+}
+
+void runScenario(const Scenario& scenario) {
+  SimNetwork::instance().begin(server, NULL, scenario.conditions);
+  Serial.print("--- ");
+  Serial.println(scenario.name);
+
+  // Request/response round trips
+  unsigned long start = millis();
+  int failed = 0;
+  for(int i = 0; i < 20; i++) {
+    if(!constellation.pushStateObject("Counter", i)) {
+      failed++;
+    }
+  }
+  Serial.print("pushStateObject: ");
+  Serial.print((millis() - start) / 20.0);
+  Serial.print(" ms per request, ");
+  Serial.print(failed);
+  Serial.println(" failed");
+
+  // Long-poll latency : from the publication of a tick to its MessageCallback
+  tickCount = tickLatency = 0;
+  nextTick = millis() + TICK_INTERVAL;
+  start = millis();
+  while(millis() - start < 3000) {
+    constellation.loop();
+  }
+  Serial.print("Long-poll: ");
+  Serial.print(tickCount);
+  Serial.print(" ticks received, ");
+  Serial.print(tickCount > 0 ? (float)tickLatency / tickCount : 0);
+  Serial.println(" ms average latency");
+
+  const SimStats& stats = SimNetwork::instance().stats;
+  Serial.print("Link: ");
+  Serial.print(stats.connects);
+  Serial.print(" connections, ");
+  Serial.print(stats.requests);
+  Serial.print(" requests, ");
+  Serial.print(stats.resets);
+  Serial.print(" resets, ");
+  Serial.print(stats.halfOpen);
+  Serial.println(" half-open");
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  constellation.setDebugMode(Error);
+  constellation.setTimeout(1000);  // the half-open sockets are detected by this timeout
+
+  SimNetwork::instance().begin(server, NULL, scenarios[0].conditions);
+  constellation.registerMessageCallback("Tick", [](JsonObject& json) {
+    tickLatency += millis() - json["Data"].as<unsigned long>();
+    tickCount++;
+  });
+  constellation.subscribeToMessage();
+
+  for(unsigned int i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    runScenario(scenarios[i]);
+  }
+  const ConnectionStats& stats = constellation.getConnectionStats();
+  Serial.print("Library: ");
+  Serial.print(stats.connects);
+  Serial.print(" connections, ");
+  Serial.print(stats.staleReconnects);
+  Serial.print(" stale reconnects, ");
+  Serial.print(stats.retries);
+  Serial.println(" retries");
+}
+
+void loop(void) {
+}
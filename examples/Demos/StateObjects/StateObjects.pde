@@ -22,6 +22,12 @@ char password[] = "YOUR_WIFI_PASSWORD";
 /* Create the Constellation client */
 Constellation<WiFiClient> constellation("IP_or_DNS_CONSTELLATION_SERVER", 8088, "YOUR_SENTINEL_NAME", "YOUR_PACKAGE_NAME", "YOUR_ACCESS_KEY");
 
+/* Samples of a sensor read at 100 Hz, kept in 512 bytes (values rounded to 0.1) */
+TimeSeries<512> light(0.1);
+
+/* Summary of the same sensor over the last minute, pushed every 15 seconds (4 panes of 15 s) */
+WindowAggregator<4> lightStats(60000);
+
 void setup(void) {
   Serial.begin(115200);  delay(10);
 
@@ -42,6 +48,18 @@ void setup(void) {
   // Describe your custom StateObject types  
   constellation.addStateObjectType("MyLuxData", TypeDescriptor().setDescription("MyLuxData demo").addProperty<int>("Broadband").addProperty<int>("IR").addProperty<int>("Lux"));
   
+  // Push the samples together : one StateObject "Light" (type "TimeSeries", declared below) every 5 seconds
+  constellation.publishStateObject("Light", light, 5000);
+  // Push a summary (count, min, max, mean, standard deviation & percentiles, type "WindowStats") instead of the readings
+  lightStats.addPercentile(50).addPercentile(95);
+  constellation.publishStateObject("LightStats", lightStats, lightStats.interval());
+  // Sample every 10 ms, also while Constellation waits for the server
+  constellation.addTask([]() {
+    float value = analogRead(A0) * 0.1;
+    light.add(value);
+    lightStats.add(value);
+  }, 10, true);
+
   // Declare the package descriptor
   constellation.declarePackageDescriptor();
 
@@ -22,12 +22,6 @@ char password[] = "YOUR_WIFI_PASSWORD";
 /* Create the Constellation client */
 Constellation<WiFiClient> constellation("IP_or_DNS_CONSTELLATION_SERVER", 8088, "YOUR_SENTINEL_NAME", "YOUR_PACKAGE_NAME", "YOUR_ACCESS_KEY");
 
-#include <Thread.h>
-#include <ThreadController.h>
-ThreadController thrController = ThreadController();
-Thread thrDoMeasure1 = Thread();
-Thread thrDoMeasure2 = Thread();
-
 void setup(void) {
   Serial.begin(115200);  delay(10);
   
@@ -72,19 +66,17 @@ void setup(void) {
       constellation.writeInfo("Hello %s", json["Data"].asString());
    });
 
-  // Write info & Push simple StateObject every 10 seconds
-  thrDoMeasure1.onRun([]() {
+  // Write info & Push simple StateObject every 10 seconds (tasks are run by constellation.loop())
+  constellation.addTask([]() {
     // Write info
     constellation.writeInfo("I'm here !");
     // Push a simple type on Constellation
     uint32_t lux = 42; // Dummy value !
     constellation.pushStateObject("Lux", lux);
-  });
-  thrDoMeasure1.setInterval(10000);
-  thrController.add(&thrDoMeasure1);
+  }, 10000);
 
   // Push complex StateObject every second
-  thrDoMeasure2.onRun([]() {
+  constellation.addTask([]() {
     // Push a complex object on Constellation with JsonObject and custom type
     const int BUFFER_SIZE = JSON_OBJECT_SIZE(5);
     StaticJsonBuffer<BUFFER_SIZE> jsonBuffer;
@@ -93,9 +85,12 @@ void setup(void) {
     myStateObject["Broadband"] = 123; // Dummy value !
     myStateObject["IR"] = 6; // Dummy value !
     constellation.pushStateObject("Lux2", myStateObject, "MyLuxData");
-  });
-  thrDoMeasure2.setInterval(1000);
-  thrController.add(&thrDoMeasure2);
+  }, 1000);
+
+  // Skip the pushes when the StateObjects have not changed (Lux2 is pushed every second)
+  constellation.setDeltaPublishing(true);
+  // and push "Lux" only when it changes by 5 or more, at most once a minute
+  constellation.setPublishRule("Lux", 5, 60000);
 
   // Describe a custom StateObject type
   constellation.addStateObjectType("MyLuxData", TypeDescriptor().setDescription("MyLuxData demo").addProperty<int>("Broadband").addProperty<int>("IR").addProperty<int>("Lux"));	
@@ -108,8 +103,6 @@ void setup(void) {
 }
 
 void loop(void) {
-  // Process incoming message & StateObject updates
+  // Process incoming message & StateObject updates, and run the tasks
   constellation.loop();
-  // Process threads
-  thrController.run();
 }
@@ -5,7 +5,7 @@
 char ssid[] = "YOUR_SSID";
 char password[] = "YOUR_WIFI_PASSWORD";
 
-// Constellation client (use WiFiClientSecure for SSL)
+// Constellation client (use WiFiClientSecure for SSL : the TLS sessions are resumed on reconnection)
 Constellation<WiFiClient> constellation("IP_or_DNS_CONSTELLATION_SERVER", 8088, "YOUR_SENTINEL_NAME", "YOUR_PACKAGE_NAME", "YOUR_ACCESS_KEY");
 
 void setup(void) {
@@ -27,6 +27,9 @@ void setup(void) {
   }
   Serial.println("WiFi connected. IP: ");
   Serial.println(WiFi.localIP());
+
+  // Open the connections now (with SSL, the handshakes are done here rather than on the first requests)
+  constellation.warmUp();
   
   // Get package settings (see BasicDemo example)
   // Register StateObjectLinks (see StateObjectsDemo example)
@@ -0,0 +1,218 @@
+#define DESCRIPTOR_MAX_MEMBERS 4    // fixed-size descriptors
+#include <Constellation.h>
+
+/* The heap-free mode (see HeapFreeProfile) checked on a Linux host : malloc is replaced by a counting one, and every
+   allocation made by loop() (long-polls, dispatch of the messages & StateObjects, saga responses) or by the requests
+   sent by the sketch is reported. The server is simulated by a client without any allocation. No network needed.
+   Not an example : it's built for the host, with an Arduino core for Linux (ex: EpoxyDuino) and ArduinoJson 5. */
+
+#if !defined(__linux__) || !defined(__GLIBC__)
+#error "This test replaces the malloc of the GNU C library : Linux host only"
+#endif
+
+#define ITERATIONS 100
+
+/* Allocations counted while 'tracking' (operator new calls malloc) */
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+volatile bool tracking = false;
+volatile unsigned long allocations = 0;
+
+extern "C" void* malloc(size_t size) {
+  if(tracking) {
+    allocations++;
+  }
+  return __libc_malloc(size);
+}
+extern "C" void* calloc(size_t count, size_t size) {
+  if(tracking) {
+    allocations++;
+  }
+  return __libc_calloc(count, size);
+}
+extern "C" void* realloc(void* p, size_t size) {
+  if(tracking) {
+    allocations++;
+  }
+  return __libc_realloc(p, size);
+}
+
+/* The simulated server : a saga message "Add" and a StateObject on each long-poll, 204 for everything else */
+const char* reply(const char* request) {
+  if(strstr(request, "/SubscribeToMessage") != NULL) {
+    return "HTTP/1.1 200 OK\r\nContent-Length: 38\r\n\r\n\"00000000-0000-0000-0000-000000000001\"";
+  }
+  if(strstr(request, "/SubscribeToStateObjects") != NULL) {
+    return "HTTP/1.1 200 OK\r\nContent-Length: 38\r\n\r\n\"00000000-0000-0000-0000-000000000002\"";
+  }
+  if(strstr(request, "/GetMessages") != NULL) {
+    return "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "7A\r\n[{\"Key\":\"Add\",\"Data\":[1,2],\"Scope\":{\"Scope\":3,\"SagaId\":\"42\"},\"Sender\":{\"Type\":1,\"FriendlyName\":\"Sim\",\"ConnectionId\":\"1\"}}]\r\n0\r\n\r\n";
+  }
+  if(strstr(request, "/GetStateObjects") != NULL) {
+    return "HTTP/1.1 200 OK\r\nContent-Length: 80\r\n\r\n[{\"StateObject\":{\"SentinelName\":\"S\",\"PackageName\":\"P\",\"Name\":\"Lux\",\"Value\":42}}]";
+  }
+  return "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n";
+}
+
+/* Answers each request as soon as it is written, from fixed buffers */
+class CannedClient : public Client {
+  private:
+    char _request[2048];
+    size_t _requestLength = 0;
+    const char* _response = NULL;
+    bool _open = false;
+
+    // A whole request : the headers, the body (Content-Length) and its "\r\n\r\n"
+    bool requestComplete() {
+      const char* end = strstr(_request, "\r\n\r\n");
+      if(end == NULL) {
+        return false;
+      }
+      const char* length = strstr(_request, "Content-Length: ");
+      size_t body = length != NULL && length < end ? atoi(length + 16) + 4 : 0;
+      return _requestLength >= (size_t)(end + 4 - _request) + body;
+    }
+
+  public:
+    int connect(IPAddress ip, uint16_t port) {
+      _open = true;
+      return 1;
+    }
+    int connect(const char* host, uint16_t port) {
+      _open = true;
+      return 1;
+    }
+    size_t write(uint8_t c) {
+      return write(&c, 1);
+    }
+    size_t write(const uint8_t* data, size_t size) {
+      if(_requestLength + size >= sizeof(_request)) {
+        return 0;
+      }
+      memcpy(_request + _requestLength, data, size);
+      _requestLength += size;
+      _request[_requestLength] = '\0';
+      if(requestComplete()) {
+        _response = reply(_request);
+        _requestLength = 0;
+      }
+      return size;
+    }
+    int available() {
+      return _open && _response != NULL ? strlen(_response) : 0;
+    }
+    int read() {
+      return available() > 0 ? (uint8_t)*_response++ : -1;
+    }
+    int read(uint8_t* buffer, size_t size) {
+      size_t length = 0;
+      while(length < size && available() > 0) {
+        buffer[length++] = *_response++;
+      }
+      return length;
+    }
+    int peek() {
+      return available() > 0 ? (uint8_t)*_response : -1;
+    }
+    void flush() {
+    }
+    void stop() {
+      _open = false;
+      _response = NULL;
+      _requestLength = 0;
+    }
+    uint8_t connected() {
+      return _open;
+    }
+    operator bool() {
+      return _open;
+    }
+};
+
+Constellation<CannedClient, HeapFreeProfile> constellation("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+
+unsigned long messages = 0, stateObjects = 0, failures = 0;
+
+void check(const char* name) {
+  Serial.print(name);
+  if(allocations == 0) {
+    Serial.println(": OK");
+  }
+  else {
+    Serial.print(": FAILED, ");
+    Serial.print(allocations);
+    Serial.println(" allocation(s)");
+    failures++;
+  }
+  allocations = 0;
+}
+
+void onAdd(JsonObject& json, MessageContext context) {
+  messages++;
+  constellation.sendResponse(context, json["Data"][0].as<int>() + json["Data"][1].as<int>());
+}
+
+void onLux(JsonObject& so) {
+  stateObjects++;
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  constellation.setDebugMode(Error);
+
+  // Registrations & descriptors : at startup, not counted
+  constellation.registerMessageCallback("Add",
+    MessageCallbackDescriptor().setDescription("Adds two numbers").addParameter<int>("a").addParameter<int>("b").setReturnType<int>(), onAdd);
+  constellation.registerStateObjectLink("*", "*", "Lux", onLux);
+  constellation.addStateObjectType("Light", TypeDescriptor().addProperty<int>("Lux"));
+  constellation.declarePackageDescriptor();
+  constellation.loop();   // the subscriptions
+  Serial.println("Allocations on the hot paths (HeapFreeProfile):");
+
+  // The counting malloc is the one called
+  tracking = true;
+  void* volatile block = malloc(1);
+  int* volatile object = new int;
+  free(block);
+  delete object;
+  tracking = false;
+  if(allocations != 2) {
+    Serial.println("FAILED, malloc not replaced");
+    return;
+  }
+  allocations = 0;
+
+  tracking = true;
+  for(int i = 0; i < ITERATIONS; i++) {
+    constellation.loop();
+  }
+  tracking = false;
+  check("loop(), messages & StateObjects dispatched, saga responses");
+
+  tracking = true;
+  for(int i = 0; i < ITERATIONS; i++) {
+    constellation.pushStateObject("Lux", i);
+    constellation.pushStateObject("Light", "{'Lux':42}", "Light");
+  }
+  tracking = false;
+  check("pushStateObject");
+
+  tracking = true;
+  for(int i = 0; i < ITERATIONS; i++) {
+    constellation.sendMessage(Package, "Demo", "Ping", "{'Count':%d}", i);
+    constellation.writeInfo("Iteration %d", i);
+  }
+  tracking = false;
+  check("sendMessage & writeInfo");
+
+  Serial.print(messages);
+  Serial.print(" messages & ");
+  Serial.print(stateObjects);
+  Serial.println(" StateObjects dispatched");
+  Serial.println(failures == 0 && messages >= ITERATIONS && stateObjects >= ITERATIONS ? "No allocation" : "FAILED");
+}
+
+void loop(void) {
+}
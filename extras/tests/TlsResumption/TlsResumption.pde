@@ -0,0 +1,209 @@
+#include <Constellation.h>
+
+/* TLS session resumption (see TlsSession.h) checked against a real TLS server : a local OpenSSL server with a
+   self-signed certificate, and a network class wrapping an OpenSSL client with the setSession() of the ESP8266
+   BearSSL client. warmUp() opens the three connections with full handshakes, then after a simulated WiFi drop
+   (every socket dead) the reconnections must resume their sessions. No network needed.
+   Not an example : it's built for the host (Linux, OpenSSL 1.1 or later, link with -lssl -lcrypto -lpthread),
+   with an Arduino core for Linux (ex: EpoxyDuino) and ArduinoJson 5. */
+
+#if !defined(__linux__)
+#error "This test runs a local OpenSSL server : Linux host only"
+#endif
+
+#include <thread>
+#include <vector>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+int epoch = 0;                  // incremented on a simulated WiFi drop : every open socket is dead
+int fullHandshakes = 0, resumedHandshakes = 0;
+
+/* The TLS session kept by the library for each connection */
+struct OpenSslSession {
+  SSL_SESSION* session = NULL;
+};
+
+/* Network class : OpenSSL client (TLS 1.2, the certificate is not verified) */
+class OpenSslClient : public Client {
+  private:
+    SSL* _ssl = NULL;
+    int _socket = -1;
+    int _epoch = 0;
+    OpenSslSession* _session = NULL;
+
+    static SSL_CTX* context() {
+      static SSL_CTX* context = NULL;
+      if(context == NULL) {
+        context = SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_max_proto_version(context, TLS1_2_VERSION);
+      }
+      return context;
+    }
+
+  public:
+    void setSession(OpenSslSession* session) {
+      _session = session;
+    }
+
+    int connect(IPAddress ip, uint16_t port) {
+      return 0;
+    }
+    int connect(const char* host, uint16_t port) {
+      stop();
+      char service[8];
+      snprintf(service, sizeof(service), "%u", port);
+      struct addrinfo hints = {}, *address;
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_STREAM;
+      if(getaddrinfo(host, service, &hints, &address) != 0) {
+        return 0;
+      }
+      _socket = socket(address->ai_family, address->ai_socktype, 0);
+      bool connected = ::connect(_socket, address->ai_addr, address->ai_addrlen) == 0;
+      freeaddrinfo(address);
+      if(!connected) {
+        stop();
+        return 0;
+      }
+      _ssl = SSL_new(context());
+      SSL_set_fd(_ssl, _socket);
+      if(_session != NULL && _session->session != NULL) {
+        SSL_set_session(_ssl, _session->session);
+      }
+      if(SSL_connect(_ssl) != 1) {
+        stop();
+        return 0;
+      }
+      if(SSL_session_reused(_ssl)) {
+        resumedHandshakes++;
+      }
+      else {
+        fullHandshakes++;
+      }
+      if(_session != NULL) {
+        // A copy : OpenSSL invalidates the session of a connection closed without shutdown (the drops simulated here)
+        SSL_SESSION_free(_session->session);
+        _session->session = SSL_SESSION_dup(SSL_get_session(_ssl));
+      }
+      _epoch = epoch;
+      return 1;
+    }
+    size_t write(uint8_t c) {
+      return write(&c, 1);
+    }
+    size_t write(const uint8_t* buffer, size_t size) {
+      return connected() && SSL_write(_ssl, buffer, size) > 0 ? size : 0;
+    }
+    int available() {
+      return connected() ? SSL_pending(_ssl) : 0;
+    }
+    int read() {
+      uint8_t c;
+      return read(&c, 1) == 1 ? c : -1;
+    }
+    int read(uint8_t* buffer, size_t size) {
+      return available() > 0 ? SSL_read(_ssl, buffer, size) : -1;
+    }
+    int peek() {
+      return -1;
+    }
+    void flush() {
+    }
+    void stop() {
+      if(_ssl != NULL) {
+        SSL_free(_ssl);
+        _ssl = NULL;
+      }
+      if(_socket >= 0) {
+        close(_socket);
+        _socket = -1;
+      }
+    }
+    uint8_t connected() {
+      if(_ssl != NULL && _epoch != epoch) {
+        stop();
+      }
+      return _ssl != NULL;
+    }
+    operator bool() {
+      return connected();
+    }
+};
+
+/* Local TLS server : accepts the connections & completes the handshakes, with a self-signed certificate */
+uint16_t startServer() {
+  EVP_PKEY* key = EVP_EC_gen("P-256");
+  X509* certificate = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+  X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+  X509_gmtime_adj(X509_getm_notAfter(certificate), 3600);
+  X509_set_pubkey(certificate, key);
+  X509_NAME_add_entry_by_txt(X509_get_subject_name(certificate), "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+  X509_set_issuer_name(certificate, X509_get_subject_name(certificate));
+  X509_sign(certificate, key, EVP_sha256());
+  SSL_CTX* context = SSL_CTX_new(TLS_server_method());
+  SSL_CTX_use_certificate(context, certificate);
+  SSL_CTX_use_PrivateKey(context, key);
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  bind(listener, (struct sockaddr*)&address, sizeof(address));
+  listen(listener, 8);
+  getsockname(listener, (struct sockaddr*)&address, &length);
+  std::thread([context, listener]() {
+    std::vector<SSL*> connections;      // kept open, as the keep-alive connections of a Constellation server
+    while(true) {
+      int connection = accept(listener, NULL, NULL);
+      SSL* ssl = SSL_new(context);
+      SSL_set_fd(ssl, connection);
+      SSL_accept(ssl);
+      connections.push_back(ssl);
+    }
+  }).detach();
+  return ntohs(address.sin_port);
+}
+
+/* The server is started first : its port is picked by the system */
+uint16_t port = startServer();
+Constellation<OpenSslClient> constellation("localhost", port, "Sentinel", "Package", "Key");
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  constellation.setDebugMode(Error);
+
+  unsigned long start = micros();
+  bool success = constellation.warmUp();
+  Serial.print("Cold start: ");
+  Serial.print(fullHandshakes);
+  Serial.print(" full handshakes, ");
+  Serial.print(resumedHandshakes);
+  Serial.print(" resumed, ");
+  Serial.print((micros() - start) / 1000.0);
+  Serial.println(" ms");
+  success &= fullHandshakes == 3 && resumedHandshakes == 0;
+
+  epoch++;
+  fullHandshakes = resumedHandshakes = 0;
+  start = micros();
+  success &= constellation.warmUp();
+  Serial.print("After a WiFi drop: ");
+  Serial.print(fullHandshakes);
+  Serial.print(" full handshakes, ");
+  Serial.print(resumedHandshakes);
+  Serial.print(" resumed, ");
+  Serial.print((micros() - start) / 1000.0);
+  Serial.println(" ms");
+  success &= fullHandshakes == 0 && resumedHandshakes == 3;
+  Serial.println(success ? "OK" : "FAILED");
+}
+
+void loop(void) {
+}
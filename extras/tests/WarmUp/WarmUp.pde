@@ -0,0 +1,73 @@
+#include <Constellation.h>
+#include <SimClient.h>
+
+/* The long-polls after warmUp() : the connections are opened in advance, then loop() must still send GetMessages and
+   GetStateObjects on them (and re-arm them once answered). The server is simulated (see SimClient.h). No network needed.
+   Not an example : it's built for the host, with an Arduino core for Linux (ex: EpoxyDuino) and ArduinoJson 5. */
+
+#define LOOPS 10
+
+Constellation<SimClient> constellation("sim", 8088, "SimSentinel", "SimPackage", "SimKey");
+
+// connectTime, rtt, jitter, bandwidth, chunkSize, chunkGap, maxAvailable, refuseEvery, resetEvery, halfOpenEvery
+SimConditions instant = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+unsigned long getMessages = 0, getStateObjects = 0, messages = 0, stateObjects = 0;
+
+unsigned long respond(Print& response, int code, const char* body) {
+  response.print("HTTP/1.1 ");
+  response.print(code);
+  response.print(" OK\r\nContent-Type: application/json\r\nContent-Length: ");
+  response.print(strlen(body));
+  response.print("\r\n\r\n");
+  response.print(body);
+  return 0;
+}
+
+unsigned long server(const char* request, Print& response, void* context) {
+  if(strstr(request, "/SubscribeToMessage") != NULL || strstr(request, "/SubscribeToStateObjects") != NULL) {
+    return respond(response, 200, "\"00000000-0000-0000-0000-000000000000\"");
+  }
+  if(strstr(request, "/GetMessages") != NULL) {
+    getMessages++;
+    return respond(response, 200, "[{\"Key\":\"Tick\",\"Data\":1,\"Scope\":{\"Scope\":3},\"Sender\":{\"Type\":1,\"FriendlyName\":\"Sim\"}}]");
+  }
+  if(strstr(request, "/GetStateObjects") != NULL) {
+    getStateObjects++;
+    return respond(response, 200, "[{\"StateObject\":{\"SentinelName\":\"S\",\"PackageName\":\"P\",\"Name\":\"Lux\",\"Value\":42}}]");
+  }
+  return respond(response, 204, "");
+}
+
+void setup(void) {
+  Serial.begin(115200);  delay(10);
+  constellation.setDebugMode(Error);
+  SimNetwork::instance().begin(server, NULL, instant);
+
+  constellation.setMessageReceiveCallback([](JsonObject& json) {
+    messages++;
+  });
+  constellation.registerStateObjectLink("S", "P", "Lux", [](JsonObject& so) {
+    stateObjects++;
+  });
+  constellation.subscribeToMessage();
+  constellation.warmUp();
+
+  for(int i = 0; i < LOOPS; i++) {
+    constellation.loop();
+  }
+  // Each loop() reads the previous response & sends the next request : the last one is still pending
+  Serial.print(getMessages);
+  Serial.print(" GetMessages, ");
+  Serial.print(getStateObjects);
+  Serial.print(" GetStateObjects, ");
+  Serial.print(messages);
+  Serial.print(" messages & ");
+  Serial.print(stateObjects);
+  Serial.println(" StateObjects dispatched");
+  bool success = getMessages == LOOPS && getStateObjects == LOOPS && messages == LOOPS - 1 && stateObjects == LOOPS - 1;
+  Serial.println(success ? "OK" : "FAILED");
+}
+
+void loop(void) {
+}
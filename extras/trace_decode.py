@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+Decodes a Constellation binary trace, as printed by Constellation::dumpTrace().
+
+    python3 trace_decode.py capture.txt [--names names.txt]
+
+The input can be a whole serial capture : the last "CTR1 ... END" block is decoded.
+Methods, message keys & StateObject names are recorded as hashes (FNV-1a) : the method names
+are known, the others can be given with --names (one message key or StateObject name per line).
+"""
+
+import argparse
+import sys
+
+EVENTS = {
+    1: "Connect", 2: "ConnectFailed", 3: "StaleReconnect", 4: "Request", 5: "Retry", 6: "ResponseTimeout",
+    7: "ResponseHeader", 8: "ResponseBody", 9: "DecodeError", 10: "Message", 11: "StateObject", 12: "ItemDropped",
+    13: "Duplicate",
+}
+CONNECTIONS = ["requests", "messages", "StateObjects"]
+METHODS = [
+    "DeclarePackageDescriptor", "GetMessages", "GetSettings", "GetStateObjects", "PurgeStateObjects", "PushStateObject",
+    "RequestStateObjects", "SendMessage", "SubscribeToMessage", "SubscribeToMessageGroup", "SubscribeToStateObjects", "WriteLog",
+]
+TRACE_USER = 0x8000
+
+
+def fnv1a(text):
+    h = 2166136261
+    for b in text.encode():
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def read_block(lines):
+    block = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("CTR1 "):
+            block = {"header": line.split(), "records": []}
+        elif block is not None and line == "END":
+            block["complete"] = True
+        elif block is not None and not block.get("complete") and len(line) == 24:
+            block["records"].append(line)
+    return block
+
+
+def describe(event, arg, value, names):
+    name = lambda h: names.get(h, "#%08X" % h)
+    if event in (1, 2):
+        text = CONNECTIONS[arg] if arg < len(CONNECTIONS) else str(arg)
+        return text + (" in %d ms" % value if event == 1 else "")
+    if event == 4:
+        if arg == ord("Q"):
+            return "queued, %d bytes" % value
+        return "%s %s" % ("POST" if arg == ord("P") else "GET", name(value))
+    if event == 5:
+        return name(value)
+    if event == 7:
+        return "status %d, %d header lines" % (arg, value)
+    if event == 8:
+        flags = [f for bit, f in ((1, "truncated"), (2, "MessagePack"), (4, "compressed")) if arg & bit]
+        return "%d bytes%s" % (value, (" (" + ", ".join(flags) + ")") if flags else "")
+    if event in (10, 11):
+        return name(value) if value else "?"
+    if event == 12:
+        return "%d %s" % (value, "StateObject(s)" if arg else "message(s)")
+    if event == 13:
+        return "StateObject " + name(value) if arg else "message #%08X" % value
+    return "arg=%d value=%d" % (arg, value) if (arg or value) else ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodes a Constellation binary trace")
+    parser.add_argument("input", nargs="?", help="serial capture (default: stdin)")
+    parser.add_argument("--names", help="file of message keys & StateObject names, one per line")
+    args = parser.parse_args()
+
+    names = {fnv1a(m): m for m in METHODS}
+    if args.names:
+        with open(args.names) as f:
+            names.update({fnv1a(n.strip()): n.strip() for n in f if n.strip()})
+
+    with (open(args.input, errors="replace") if args.input else sys.stdin) as f:
+        block = read_block(f)
+    if block is None:
+        sys.exit("No trace found (CTR1 line)")
+
+    capacity, recorded = int(block["header"][1]), int(block["header"][2])
+    records = block["records"]
+    print("%d events recorded, %d kept (capacity %d)%s" % (recorded, len(records), capacity, "" if block.get("complete") else ", incomplete dump"))
+    start = previous = None
+    for record in records:
+        time, event, arg, value = int(record[0:8], 16), int(record[8:12], 16), int(record[12:16], 16), int(record[16:24], 16)
+        if start is None:
+            start = previous = time
+        elapsed = (time - start) & 0xFFFFFFFF
+        delta = (time - previous) & 0xFFFFFFFF
+        previous = time
+        label = EVENTS.get(event, "User+%d" % (event - TRACE_USER) if event >= TRACE_USER else "Event%d" % event)
+        print("%12.3f ms  +%9.3f ms  %-15s %s" % (elapsed / 1000.0, delta / 1000.0, label, describe(event, arg, value, names)))
+
+
+if __name__ == "__main__":
+    main()